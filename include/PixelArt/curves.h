@@ -0,0 +1,62 @@
+#pragma once
+
+#include <PixelArt/voronoi_diagram.h>
+
+namespace pa {
+
+	// Polylines along the active edges of a diagram. Curve c is made of the mesh vertices
+	// offsets[c] .. offsets[c+1], segment i going from its vertex i to vertex i+1 along
+	// active edge edges[offsets[c] - c + i]. Closed curves end on their first vertex.
+	struct CurveList {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> vertices;
+		std::vector<uint32_t> edges; // index in the active edge list
+		std::vector<uint8_t> closed;
+
+		size_t size() const { return closed.size(); }
+		uint32_t firstEdge(size_t c) const { return offsets[c] - static_cast<uint32_t>(c); }
+
+		void clear();
+	};
+
+	// Usage : give a computed VoronoiDiagram, then compute. Active edges are linked through
+	// the vertices where exactly two of them meet. Where three meet, the two contour
+	// edges go on if the third one is a shading edge, else the two most aligned edges do.
+	// The third curve and the curves reaching any other vertex end there.
+	class CurveExtractor {
+		const VoronoiDiagram* m_diagram;
+
+		// Active edges meeting at each vertex, as 2 * edge + side where side 0 is the
+		// origin of the edge's half-edge. Vertices are numbered in order of appearance.
+		std::vector<uint32_t> m_local; // of each mesh vertex, none if not on an active edge
+		std::vector<uint32_t> m_vertices; // mesh vertex of each local one
+		std::vector<uint32_t> m_adjacency_offsets;
+		std::vector<uint32_t> m_adjacency;
+		// incidence the curve goes on with after each one (2 * edge + side), none if it ends there
+		std::vector<uint32_t> m_next;
+
+		CurveList m_curves;
+
+		// mesh vertex of one side of an active edge
+		uint32_t vertex(uint32_t incidence) const;
+
+		void buildAdjacency();
+		void joinEdges();
+		void joinJunction(const uint32_t* incidences);
+		void traceCurves();
+
+	public:
+		CurveExtractor();
+
+		void setDiagram(const VoronoiDiagram& diagram);
+
+		void compute();
+
+		// get computed curves
+		const CurveList& getCurves() const;
+
+		// get underlying diagram
+		const VoronoiDiagram* getDiagram() const { return m_diagram; }
+	};
+
+}
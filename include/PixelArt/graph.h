@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <SFML/Graphics.hpp>
 #include "hash.h"
 
@@ -12,29 +13,48 @@ namespace pa {
 	using IntPoint = sf::Vector2i;
 	using Point = sf::Vector2f;
 
-	// lexical order
-	static bool operator<(const Point& pa, const Point& pb) {
-		return (pa.x < pb.x) || (pa.y < pb.y);
+	// Voronoi vertices all lie on the quarter pixel lattice. They are identified
+	// by their integer lattice coordinates (4x, 4y), packed x high, y low.
+	using LatticePoint = uint64_t;
+
+	inline LatticePoint lattice_point(int qx, int qy) {
+		return (uint64_t(uint32_t(qx)) << 32) | uint32_t(qy);
+	}
+
+	inline int lattice_x(LatticePoint p) { return int32_t(p >> 32); }
+	inline int lattice_y(LatticePoint p) { return int32_t(uint32_t(p)); }
+
+	// Back to image coordinates, only for output
+	inline Point to_point(LatticePoint p) {
+		return Point(static_cast<float>(lattice_x(p)) * 0.25f, static_cast<float>(lattice_y(p)) * 0.25f);
 	}
 
-	// Default structure for Edge
+	using EdgeId = uint64_t;
+
+	// Default structure for Edge, endpoints ordered so both directions are equal
 	struct Edge {
-		Point p1;
-		Point p2;
-
-		Edge(const Point& pa, const Point& pb) {
-			if (pa < pb) {
-				p1 = pa;
-				p2 = pb;
-			}
-			else {
-				p1 = pb;
-				p2 = pa;
-			}
-		}
+		LatticePoint p1;
+		LatticePoint p2;
+
+		Edge(LatticePoint pa, LatticePoint pb) :
+			p1(pa < pb ? pa : pb),
+			p2(pa < pb ? pb : pa)
+		{}
 		bool operator==(const Edge& e) const {
 			return p1 == e.p1 && p2 == e.p2;
 		}
+
+		// Integer id of an edge between close lattice points : p1 on 24 bits per
+		// coordinate, then the offset to p2 on 8 bits per coordinate.
+		EdgeId id() const {
+			return (uint64_t(lattice_x(p1)) << 40) | (uint64_t(lattice_y(p1)) << 16)
+				| (uint64_t(uint8_t(lattice_x(p2) - lattice_x(p1))) << 8) | uint8_t(lattice_y(p2) - lattice_y(p1));
+		}
+
+		static Edge fromId(EdgeId id) {
+			int x = int(id >> 40), y = int((id >> 16) & 0xFFFFFF);
+			return Edge(lattice_point(x, y), lattice_point(x + int8_t(id >> 8), y + int8_t(id)));
+		}
 	};
 
 	// Edge visibility
@@ -61,6 +81,11 @@ namespace pa {
 	};
 #define NUM_DIR Direction::CENTER
 
+	// Thanks to clockwise order, opposite direction is half a turn away
+	inline Direction opposite(Direction d) {
+		return static_cast<Direction>((d + NUM_DIR / 2) % NUM_DIR);
+	}
+
 	const std::array<IntPoint, NUM_DIR + 1> VecDir
 	{
 		sf::Vector2i(-1,-1),
@@ -73,25 +98,4 @@ namespace pa {
 		sf::Vector2i(0,-1),
 		sf::Vector2i(0,0),
 	};
-}
-
-// Hash functions
-
-namespace std {
-	template <> struct hash<pa::Point>
-	{
-		size_t operator()(const pa::Point& p) const
-		{
-			return ((hash<float>()(p.x)
-				^ (hash<float>()(p.y) << 1)) >> 1);
-		}
-	};
-
-	template <> struct hash<pa::Edge>
-	{
-		size_t operator()(const pa::Edge& e) const
-		{
-			return pa::PairHasher<pa::Point, pa::Point>()(std::pair(e.p1, e.p2));
-		}
-	};
 }
\ No newline at end of file
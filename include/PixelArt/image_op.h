@@ -1,5 +1,8 @@
 #pragma once
 #include "graph.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
 #include <SFML/Graphics.hpp>
 
 /* To do operation on graph / images */
@@ -11,21 +14,86 @@ namespace pa {
 
 		ColorYUV() : Y(0.0), U(0.0), V(0.0) {}
 		ColorYUV(float a, float b, float c) : Y(a), U(b), V(c) {}
-		// Converts RGB to YUV
+		// Converts RGB to YUV. Float constants, so that YUVPlanes vectorized conversion
+		// gives the exact same values.
 		void convertRGB(const sf::Color& c) {
-			Y= (0.299 * c.r + 0.587 * c.g + 0.114 * c.b);
-			U = 0.492 * (static_cast<float>(c.b) - Y);
-			V = 0.877 * (static_cast<float>(c.r) - Y);
+			Y = 0.299f * c.r + 0.587f * c.g + 0.114f * c.b;
+			U = 0.492f * (static_cast<float>(c.b) - Y);
+			V = 0.877f * (static_cast<float>(c.r) - Y);
 		}
 	};
 
+	// Whole image converted once to YUV, one plane per channel.
+	// Pixel (x,y) is at index y * dim.x + x, as in the sf::Image pixel array.
+	struct YUVPlanes {
+		sf::Vector2u dim;
+		std::vector<float> Y, U, V;
+
+		YUVPlanes() : dim(0, 0) {}
+		explicit YUVPlanes(const sf::Image& image) { convert(image); }
+
+		size_t index(int x, int y) const { return static_cast<size_t>(y) * dim.x + static_cast<size_t>(x); }
+
+		// (Re)computes the planes from image, with SSE/AVX when available
+		void convert(const sf::Image& image);
+	};
+
+	// Distinct colors of an image, and palette index of each pixel.
+	// Pixel (x,y) is at index y * dim.x + x, as in the sf::Image pixel array.
+	struct Palette {
+		static constexpr size_t max_colors = 256;
+
+		sf::Vector2u dim;
+		std::vector<sf::Color> colors;
+		std::vector<uint8_t> indices;
+
+		Palette() : dim(0, 0) {}
+
+		size_t index(int x, int y) const { return static_cast<size_t>(y) * dim.x + static_cast<size_t>(x); }
+		uint8_t operator()(int x, int y) const { return indices[index(x, y)]; }
+		bool empty() const { return colors.empty(); }
+
+		// Extracts the palette. Returns false and stays empty if image has more than max_colors colors
+		bool extract(const sf::Image& image);
+	};
+
+	// N*N table of Bits wide values, indexed by a pair of palette indices
+	template<int Bits>
+	class PaletteTable {
+		static_assert(Bits == 1 || Bits == 2 || Bits == 4, "entries must not straddle bytes");
+		size_t n = 0;
+		std::vector<uint8_t> data;
+
+	public:
+		// Fills the table with f(i, j) for all 0 <= i, j < size
+		template<class F>
+		void build(size_t size, F f) {
+			n = size;
+			data.assign((n * n * Bits + 7) / 8, 0);
+			for (size_t i = 0; i < n; i++)
+				for (size_t j = 0; j < n; j++) {
+					size_t bit = (i * n + j) * Bits;
+					data[bit >> 3] = static_cast<uint8_t>(data[bit >> 3] | static_cast<unsigned>(f(i, j)) << (bit & 7));
+				}
+		}
+
+		uint8_t operator()(size_t i, size_t j) const {
+			size_t bit = (i * n + j) * Bits;
+			return (data[bit >> 3] >> (bit & 7)) & ((1 << Bits) - 1);
+		}
+
+		bool empty() const { return n == 0; }
+	};
+
 	// Pixel Graph parameters for similarity graph calculation
 	// image on which to render, and YUV distance parameters.
+	// use_palette : do the tests through palette tables when the image has few enough colors.
 	struct PixelGraphParam {
 		const sf::Image& image;
 		ColorYUV color;
-		PixelGraphParam(const sf::Image& im, ColorYUV c_yuv = ColorYUV({ 42.0, 7.0, 6.0 }))
-			: image(im), color(c_yuv) {}
+		bool use_palette;
+		PixelGraphParam(const sf::Image& im, ColorYUV c_yuv = ColorYUV({ 42.0, 7.0, 6.0 }), bool palette = false)
+			: image(im), color(c_yuv), use_palette(palette) {}
 	};
 
 	// Functor to do the similarity test on adjacent pixel
@@ -35,17 +103,46 @@ namespace pa {
 		using return_type = bool;
 
 		param_type param; // parameters. Here it will be PixelGraphParam
+		YUVPlanes planes; // param.image converted once, if not in palette mode
+		Palette palette; // empty if not in palette mode
+		PaletteTable<1> similar; // similarity between palette colors
 
 		explicit TestYUVSimilarity(param_type param) :
 			param(param)
-		{}
+		{
+			// fall back to planes if too many colors
+			if (param.use_palette && palette.extract(param.image))
+				buildTable();
+			else
+				planes.convert(param.image);
+		}
+
+		// new thresholds
+		void setColor(const ColorYUV& color) {
+			param.color = color;
+			if (!palette.empty())
+				buildTable();
+		}
+
+		// same test as below, on palette colors
+		void buildTable() {
+			similar.build(palette.colors.size(), [this](size_t i, size_t j) {
+				ColorYUV c1; c1.convertRGB(palette.colors[i]);
+				ColorYUV c2; c2.convertRGB(palette.colors[j]);
+				return std::abs(c1.Y - c2.Y) < param.color.Y
+					&& std::abs(c1.U - c2.U) < param.color.U
+					&& std::abs(c1.V - c2.V) < param.color.V;
+			});
+		}
 
 		return_type operator()(const arg_type& p1, const arg_type& p2) const {
-			ColorYUV c1; c1.convertRGB(param.image.getPixel(p1.x, p1.y));
-			ColorYUV c2; c2.convertRGB(param.image.getPixel(p2.x, p2.y));
-			return std::abs(c1.Y - c2.Y) < param.color.Y
-				&& std::abs(c1.U - c2.U) < param.color.U
-				&& std::abs(c1.V - c2.V) < param.color.V;
+			if (!palette.empty())
+				return similar(palette(p1.x, p1.y), palette(p2.x, p2.y));
+			size_t i1 = planes.index(p1.x, p1.y);
+			size_t i2 = planes.index(p2.x, p2.y);
+			return std::abs(planes.Y[i1] - planes.Y[i2]) < param.color.Y
+				&& std::abs(planes.U[i1] - planes.U[i2]) < param.color.U
+				&& std::abs(planes.V[i1] - planes.V[i2]) < param.color.V;
 		}
 	};
 
@@ -54,7 +151,7 @@ namespace pa {
 	struct EdgeDissimilarityParam {
 		float shadingYUVDistance;
 		float contourYUVDistance;
-		EdgeDissimilarityParam(float a = 4.0/255.0, float b = 100.0/255.0) : shadingYUVDistance(a), contourYUVDistance(b) {}
+		EdgeDissimilarityParam(float a = static_cast<float>(4.0/255.0), float b = static_cast<float>(100.0/255.0)) : shadingYUVDistance(a), contourYUVDistance(b) {}
 	};
 
 	// Functor to do edge type calculation.
@@ -109,5 +206,13 @@ namespace pa {
 			return func.param;
 		}
 
+		Op& getOp() {
+			return func;
+		}
+
+		const Op& getOp() const {
+			return func;
+		}
+
 	};
 }
\ No newline at end of file
@@ -1 +1,50 @@
-// interpolation.hpp
\ No newline at end of file
+// interpolation.hpp
+#ifndef INTERPOLATION_HPP
+#define INTERPOLATION_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace hpc
+{
+    class interpolation_impl;
+
+    // Batch of curves interpolated through their knots. x and y hold the knots of all the
+    // curves as structure of arrays : knot i of curve c is x[i * curves + c], y[i * curves + c].
+    // Every curve has the same number of knots, at least 2, with increasing abscissae.
+    class interpolation
+    {
+    public:
+
+        enum class method
+        {
+            linear,
+            spline // natural cubic spline
+        };
+
+        interpolation(std::vector<double> x, std::vector<double> y, size_t curves, method m);
+        ~interpolation();
+
+        interpolation(interpolation&&);
+        interpolation& operator=(interpolation&&);
+
+        size_t curves() const;
+        size_t knots() const;
+
+        // value of curve c at x, extrapolated from the end intervals
+        double interpolate(size_t curve, double x) const;
+
+        // out[c] = value of curve c at x[c], for all the curves
+        void interpolate(const double* x, double* out) const;
+
+        // out[j * curves + c] = value of curve c at xs[j], for increasing xs[0] .. xs[count - 1]
+        void resample(const double* xs, size_t count, double* out) const;
+
+    private:
+
+        std::unique_ptr<interpolation_impl> p_impl;
+    };
+}
+
+#endif
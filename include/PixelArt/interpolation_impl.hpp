@@ -1,25 +1,86 @@
 #ifndef INTERPOLATION_IMPL_HPP
 #define INTERPOLATION_IMPL_HPP
 
+#include <cstddef>
 #include <vector>
 
 namespace hpc
 {
+    // Knots of a batch of curves, all with the same number of knots (at least 2), stored as
+    // structure of arrays : knot i of curve c is at index i * curves + c, so that loops over
+    // the curves vectorize. The abscissae of each curve strictly increase. A batch may have
+    // no curve. Batched evaluations reuse scratch buffers, so an object is not to be shared
+    // between threads.
     class interpolation_impl
     {
     public:
 
-        double interpolate(double x) const;
+        interpolation_impl(std::vector<double> x, std::vector<double> y, size_t curves);
+        virtual ~interpolation_impl() = default;
+
+        size_t curves() const;
+        size_t knots() const;
+
+        // value of curve c at x, extrapolated from the end intervals
+        double interpolate(size_t curve, double x) const;
+
+        // out[c] = value of curve c at x[c], for all the curves
+        void interpolate(const double* x, double* out) const;
+
+        // out[j * curves + c] = value of curve c at xs[j], for increasing xs[0] .. xs[count - 1]
+        void resample(const double* xs, size_t count, double* out) const;
+
+    protected:
+
+        // value of curve c at x, between its knots k and k + 1
+        virtual double value(size_t curve, size_t k, double x) const = 0;
+
+        // out[c] = value of curve c at x[c], between its knots k[c] and k[c] + 1
+        virtual void values(const size_t* k, const double* x, double* out) const = 0;
+
+        std::vector<double> m_x;
+        std::vector<double> m_y;
+        size_t m_curves;
+
+    private:
+
+        // intervals and abscissae of the curves in batched evaluations
+        mutable std::vector<size_t> m_intervals;
+        mutable std::vector<double> m_abscissae;
+
+        // interval of curve c containing x, clamped to the first and last ones
+        size_t find_interval(size_t curve, double x) const;
     };
 
-    /*class linear_interpolation : public interpolation_impl
+    class linear_interpolation : public interpolation_impl
     {
-    };*/
+    public:
 
+        using interpolation_impl::interpolation_impl;
+
+    protected:
+
+        double value(size_t curve, size_t k, double x) const override;
+        void values(const size_t* k, const double* x, double* out) const override;
+    };
+
+    // Natural cubic splines, second derivatives solved for all the curves at once
     class spline_interpolation : public interpolation_impl
     {
+    public:
+
+        spline_interpolation(std::vector<double> x, std::vector<double> y, size_t curves);
+
+    protected:
+
+        double value(size_t curve, size_t k, double x) const override;
+        void values(const size_t* k, const double* x, double* out) const override;
+
+    private:
+
+        // second derivatives at the knots, same layout as m_y
+        std::vector<double> m_y2;
     };
 }
 
 #endif
-
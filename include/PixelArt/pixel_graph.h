@@ -1,14 +1,51 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
 #include "image_op.h"
 #include "graph.h"
 
 namespace pa {
-	// weight is 0 if no edge, > 0 otherwise
-	using weight_per_dir = std::array<int, NUM_DIR>;
-	using pixel_graph_edges = std::vector<std::vector<weight_per_dir>>;
+	// bit k is set if there is an edge in kth direction
+	using neighbour_mask = uint8_t;
+	// Heuristic weights of the two diagonals of a crossing square :
+	// [0] top_left <-> bottom_right, [1] top_right <-> bottom_left
+	using diagonal_weights = std::array<int, 2>;
 	using square = std::array<IntPoint, 4>;
 
+	// Compact storage of the similarity graph. One neighbour mask per pixel in a single buffer,
+	// column after column like the old graph[x][y] layout. Weights are only kept for the diagonals
+	// that cross, keyed by the index of the top_left pixel of their square; any other edge weighs 1.
+	// The image is surrounded by a border of pixels without any edge, so that neighbours (and the
+	// 8x8 window of the sparse pixels heuristic) can be read without checking bounds.
+	struct pixel_graph_edges {
+		// pixels of padding on each side
+		static constexpr int border = 3;
+
+		sf::Vector2u dim;
+		std::vector<neighbour_mask> masks;
+		std::unordered_map<size_t, diagonal_weights> cross_weights;
+		// distance between columns, index of pixel (0,0)
+		ptrdiff_t stride = 0;
+		ptrdiff_t origin = 0;
+
+		// allocates masks for an image of size d, without any edge
+		void reset(const sf::Vector2u& d) {
+			dim = d;
+			stride = static_cast<ptrdiff_t>(dim.y) + 2 * border;
+			origin = border * stride + border;
+			masks.assign(static_cast<size_t>(dim.x + 2 * border) * static_cast<size_t>(stride), 0);
+			cross_weights.clear();
+		}
+
+		// valid from -border to dim + border - 1
+		size_t index(int x, int y) const { return static_cast<size_t>(origin + x * stride + y); }
+
+		neighbour_mask operator()(int x, int y) const { return masks[index(x, y)]; }
+		neighbour_mask& operator()(int x, int y) { return masks[index(x, y)]; }
+	};
+
 
 	//Checks if the requested pixel is in range of the image
 	template<typename T, typename U>
@@ -35,42 +72,115 @@ namespace pa {
 		// Functor testing similarity between two points
 		ImageOp<TestYUVSimilarity> m_test_similarity;
 
-		// graph[i][j][k] -> denotes whether there is a an edge from (i,j) in kth direction in the graph
+		// m_graph(i,j) bit k -> denotes whether there is a an edge from (i,j) in kth direction in the graph
 		pixel_graph_edges m_graph;
 
+		// Masks before crossing resolution, for update. Taken by the first update after compute,
+		// empty before.
+		std::vector<neighbour_mask> m_initial_masks;
+		bool m_computed = false;
+
+		// Voronoi cell type of each pixel, column major
+		std::vector<uint8_t> m_cell_types;
+
 		// Just helper function to initialize m_graph
 		void init_graph();
 
+		// Fills m_cell_types from the diagonals of the graph
+		void extract_cell_types();
+
 		// get square pixels position form top_left position
 		// in this order : top_left, bottom_right, bottom_left, top_right
-		square&& get_square(const IntPoint& top_left);
+		square get_square(const IntPoint& top_left) const;
 
 		// checks for cross from top_left pixel
 		bool cross(const IntPoint& top_left) const;
 
+		// Connections other than diagonals in the square, one bit each :
+		// left, top, bottom, right sides. 15 if all colors are similar.
+		int additional_connections(const IntPoint& top_left) const;
+
 		//For removing trivial cross.
 		//Returns true if there is at least one more connection than diagonal
 		// assumes diagonal is already present
 		bool check_additional_connection_and_remove_trivial_cross(const IntPoint& p);
 
 		//How many edges for the pixel (x,y)
-		int valence(const IntPoint& p);
+		int valence(const IntPoint& p) const;
 
 		// are directions opposite ?
 		bool are_dir_opposite(Direction d1, Direction d2) const;
 
+		// Valence-2 chains of the graph, labelled once so that the curves heuristic does not
+		// walk the same chain again for every crossing on it. Chains changed by edge deletions
+		// are invalidated, and labelled again when asked for.
+		// When tracking changes (see update), also knows which pixels may differ from the previous
+		// compute, and which chains go through or end on them.
+		class CurveChains {
+			const PixelGraph& m_graph;
+			// Labels are a cache, updated by const queries
+			mutable std::vector<int> m_label; // chain of each valence-2 pixel, -1 if none
+			mutable std::vector<int> m_length; // number of edges of each chain, -1 if invalidated
+			mutable std::vector<uint8_t> m_chain_dirty; // chain reads a changed pixel
+			std::vector<uint8_t> m_dirty; // changed pixels, empty if not tracking
+
+			// labels the chain going through valence-2 pixel p, returns its label
+			size_t label_chain(const IntPoint& p) const;
+			// valid label of valence-2 pixel p
+			size_t label(const IntPoint& p) const;
+			// invalidates chains changed by the deletion of an edge of p
+			void edge_removed(const IntPoint& p);
+
+		public:
+			explicit CurveChains(const PixelGraph& graph);
+
+			bool edge(const IntPoint& p, Direction k) const { return m_graph.edge(p, k); }
+			int valence(const IntPoint& p) const { return m_graph.valence(p); }
+			neighbour_mask mask(const IntPoint& p) const { return m_graph.m_graph(p.x, p.y); }
+
+			// same as count_curve_edges
+			int curve_edges(const IntPoint& a, Direction d) const;
+			// updates labels after deletion of edge a-b
+			void edge_removed(const IntPoint& a, const IntPoint& b);
+
+			// Starts tracking changes, dirty flags being indexed as the graph masks
+			void track_changes(std::vector<uint8_t> dirty);
+			bool tracking() const { return !m_dirty.empty(); }
+			bool dirty(const IntPoint& p) const { return m_dirty[m_graph.m_graph.index(p.x, p.y)] != 0; }
+			void set_dirty(const IntPoint& p);
+			// a changed pixel is in the sparse pixels window of square top_left
+			bool window_dirty(const IntPoint& top_left) const;
+			// a changed pixel is read when counting curve edges from a in direction d
+			bool curve_dirty(const IntPoint& a, Direction d) const;
+		};
+
+		// Functions below read the graph through g, which provides edge(), valence() and mask() :
+		// this graph, or a view of it as the serial loop sees it (see compute_parallel).
+
 		// parcours 2-valence curve from 2 adjacent points. Will stop on end of 
 		// curve or beginning of cycle. returns curve length (number of edges)
-		int count_curve_edges(IntPoint a, const Direction d);
+		template<class G> int count_curve_edges(const G& g, IntPoint a, const Direction d) const;
+		int count_curve_edges(const CurveChains& chains, IntPoint a, const Direction d) const {
+			return chains.curve_edges(a, d);
+		}
+
+		//Heuristics for features, adding to the weights of the crossing diagonals
+		template<class G> void curves_heuristic(const G& g, const IntPoint& top_left, diagonal_weights& weights) const;
+		template<class G> void sparse_pixels_heuristic(const G& g, const IntPoint& top_left, diagonal_weights& weights) const;
+		template<class G> void islands_heuristic(const G& g, const IntPoint& top_left, diagonal_weights& weights) const;
 
-		// DFS on 8*8 limited grid. num_label is number of the labels to put on start point
-		// connex component.
-		void DFS_grid_limited(const IntPoint& top_left, const IntPoint& start, int grid[8][8], int num_label);
+		// Weights of both diagonals of a crossing square after all heuristics
+		template<class G> diagonal_weights heuristic_weights(const G& g, const IntPoint& top_left) const;
 
-		//Heuristics for features
-		void curves_heuristic(const IntPoint& top_left);
-		void sparse_pixels_heuristic(const IntPoint& top_left);
-		void islands_heuristic(const IntPoint& top_left);
+		// compute on several threads, with the exact same result
+		void compute_parallel(unsigned threads);
+
+		// Serial crossing resolution. If previous is given, it holds the initial masks and weights
+		// of a previous compute : heuristics are only run again if they may read a changed pixel.
+		void resolve_crossings(const pixel_graph_edges* previous);
+
+		// Tests of the heuristics against plain implementations (src/test/graph)
+		friend struct PixelGraphTest;
 
 	public:
 		PixelGraph(const PixelGraphParam& p);
@@ -81,15 +191,29 @@ namespace pa {
 		// Will look through all pixels and determine who is connected to who
 		// by similarity parameters defined in YUVGraphParam.
 		// The resulting graph will be stored in m_graph
-		void compute();
+		// threads : 1 for serial, 0 for one thread per core. Result does not depend on it.
+		void compute(unsigned threads = 1);
+
+		// Changes the YUV similarity thresholds. Edges are tested again, and if the graph was
+		// computed, only crossings which may be affected are resolved again.
+		// Result is the same as a new graph with these thresholds.
+		void update(const ColorYUV& color);
 
 		//Accessors, return const reference so no unnecessary copies are made
 		const sf::Image& getImage() const { return m_test_similarity.getParam().image; }
+		// Empty if not in palette mode
+		const Palette& getPalette() const { return m_test_similarity.getOp().palette; }
 		const pixel_graph_edges& getGraph() const { return m_graph; }
+		// Voronoi cell type (voronoiCellType) of pixel (x,y) at index x * height + y,
+		// as left by the constructor, compute or update
+		const std::vector<uint8_t>& getCellTypes() const { return m_cell_types; }
 
-		// Returns true if there is an edge from (x,y) in kth direction
+		// Returns true if there is an edge from (x,y) in kth direction.
+		// (x,y) may be up to pixel_graph_edges::border pixels out of the image.
 		bool edge(int x, int y, Direction k) const;
 		bool edge(const IntPoint& p, Direction k) const;
+		// Weight of the edge from (x,y) in kth direction, 0 if no edge
+		int weight(int x, int y, Direction k) const;
 		// Deletes edge
 		void delete_edge(int x, int y, Direction k);
 		void delete_edge(const IntPoint& p, Direction k);
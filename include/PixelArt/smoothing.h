@@ -0,0 +1,62 @@
+#pragma once
+
+#include <PixelArt/curves.h>
+#include <PixelArt/spline.h>
+
+namespace pa {
+
+	// Parameters of the relaxation of the control points
+	struct SmoothingParam {
+		int max_iterations; // sweeps over the points of a curve
+		float step; // first offset tried around each point, in pixels
+		float min_step; // a curve stops when no offset this small lowers its energy
+		float tolerance; // or when a sweep lowers its energy by less than this fraction
+		SmoothingParam(int it = 32, float s = 0.125f, float m = 1.0f / 64.0f, float tol = 1e-3f)
+			: max_iterations(it), step(s), min_step(m), tolerance(tol) {}
+	};
+
+	// Quadratic B-spline control points of the curves of a CurveList, with the same layout :
+	// point i of curve c is points[offsets[c] + i]. Fixed points are open curve ends and corners,
+	// they split the curve into pieces whose control polygons repeat their end points, so that
+	// the spline goes through them.
+	struct SplineControls {
+		std::vector<Point> points;
+		std::vector<uint8_t> fixed;
+
+		void clear();
+	};
+
+	// Usage : give a computed CurveExtractor, then compute. The control points start on the curve
+	// vertices and are moved one at a time to lower the curvature of the spline around them,
+	// integrated over its parameter, plus the fourth power of their distance to their start.
+	// Corners are kept : points where the curve turns by more than 90 degrees, or by 90 degrees
+	// without its neighbours turning the other way as in staircases.
+	class CurveSmoother {
+		const CurveExtractor* m_curves;
+		SmoothingParam m_param;
+
+		SplineControls m_controls;
+		std::vector<Point> m_initial; // curve vertices
+
+		// Both work on the distinct points of one curve, closed curves ending on their first point
+		void findCorners(size_t c);
+		void relax(size_t c);
+
+	public:
+		CurveSmoother(SmoothingParam p = SmoothingParam());
+
+		void setCurves(const CurveExtractor& curves);
+
+		void setParam(const SmoothingParam& p);
+
+		// threads : 1 for serial, 0 for one thread per core. Result does not depend on it.
+		void compute(unsigned threads = 1);
+
+		// get computed control points
+		const SplineControls& getControls() const;
+
+		// Appends the spline pieces of all the curves, cut at their fixed points, in curve order
+		void appendSplines(QuadraticBSpline& splines) const;
+	};
+
+}
@@ -1,507 +1,232 @@
-// This file is part of Eigen, a lightweight C++ template library
-// for linear algebra.
-//
-// Copyright (C) 20010-2011 Hauke Heibel <hauke.heibel@gmail.com>
-//
-// This Source Code Form is subject to the terms of the Mozilla
-// Public License v. 2.0. If a copy of the MPL was not distributed
-// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
-
-#ifndef EIGEN_SPLINE_H
-#define EIGEN_SPLINE_H
-
-#include "SplineFwd.h"
-
-namespace Eigen
-{
-    /**
-     * \ingroup Splines_Module
-     * \class Spline
-     * \brief A class representing multi-dimensional spline curves.
-     *
-     * The class represents B-splines with non-uniform knot vectors. Each control
-     * point of the B-spline is associated with a basis function
-     * \f{align*}
-     *   C(u) & = \sum_{i=0}^{n}N_{i,p}(u)P_i
-     * \f}
-     *
-     * \tparam Scalar_ The underlying data type (typically float or double)
-     * \tparam Dim_ The curve dimension (e.g. 2 or 3)
-     * \tparam _Degree Per default set to Dynamic; could be set to the actual desired
-     *                degree for optimization purposes (would result in stack allocation
-     *                of several temporary variables).
-     **/
-  template <typename Scalar_, int Dim_, int _Degree>
-  class Spline
-  {
-  public:
-    typedef Scalar_ Scalar; /*!< The spline curve's scalar type. */
-    enum { Dimension = Dim_ /*!< The spline curve's dimension. */ };
-    enum { Degree = _Degree /*!< The spline curve's degree. */ };
-
-    /** \brief The point type the spline is representing. */
-    typedef typename SplineTraits<Spline>::PointType PointType;
-    
-    /** \brief The data type used to store knot vectors. */
-    typedef typename SplineTraits<Spline>::KnotVectorType KnotVectorType;
-
-    /** \brief The data type used to store parameter vectors. */
-    typedef typename SplineTraits<Spline>::ParameterVectorType ParameterVectorType;
-    
-    /** \brief The data type used to store non-zero basis functions. */
-    typedef typename SplineTraits<Spline>::BasisVectorType BasisVectorType;
-
-    /** \brief The data type used to store the values of the basis function derivatives. */
-    typedef typename SplineTraits<Spline>::BasisDerivativeType BasisDerivativeType;
-    
-    /** \brief The data type representing the spline's control points. */
-    typedef typename SplineTraits<Spline>::ControlPointVectorType ControlPointVectorType;
-    
-    /**
-    * \brief Creates a (constant) zero spline.
-    * For Splines with dynamic degree, the resulting degree will be 0.
-    **/
-    Spline() 
-    : m_knots(1, (Degree==Dynamic ? 2 : 2*Degree+2))
-    , m_ctrls(ControlPointVectorType::Zero(Dimension,(Degree==Dynamic ? 1 : Degree+1))) 
-    {
-      // in theory this code can go to the initializer list but it will get pretty
-      // much unreadable ...
-      enum { MinDegree = (Degree==Dynamic ? 0 : Degree) };
-      m_knots.template segment<MinDegree+1>(0) = Array<Scalar,1,MinDegree+1>::Zero();
-      m_knots.template segment<MinDegree+1>(MinDegree+1) = Array<Scalar,1,MinDegree+1>::Ones();
-    }
-
-    /**
-    * \brief Creates a spline from a knot vector and control points.
-    * \param knots The spline's knot vector.
-    * \param ctrls The spline's control point vector.
-    **/
-    template <typename OtherVectorType, typename OtherArrayType>
-    Spline(const OtherVectorType& knots, const OtherArrayType& ctrls) : m_knots(knots), m_ctrls(ctrls) {}
-
-    /**
-    * \brief Copy constructor for splines.
-    * \param spline The input spline.
-    **/
-    template <int OtherDegree>
-    Spline(const Spline<Scalar, Dimension, OtherDegree>& spline) : 
-    m_knots(spline.knots()), m_ctrls(spline.ctrls()) {}
-
-    /**
-     * \brief Returns the knots of the underlying spline.
-     **/
-    const KnotVectorType& knots() const { return m_knots; }
-    
-    /**
-     * \brief Returns the ctrls of the underlying spline.
-     **/    
-    const ControlPointVectorType& ctrls() const { return m_ctrls; }
-
-    /**
-     * \brief Returns the spline value at a given site \f$u\f$.
-     *
-     * The function returns
-     * \f{align*}
-     *   C(u) & = \sum_{i=0}^{n}N_{i,p}P_i
-     * \f}
-     *
-     * \param u Parameter \f$u \in [0;1]\f$ at which the spline is evaluated.
-     * \return The spline value at the given location \f$u\f$.
-     **/
-    PointType operator()(Scalar u) const;
-
-    /**
-     * \brief Evaluation of spline derivatives of up-to given order.
-     *
-     * The function returns
-     * \f{align*}
-     *   \frac{d^i}{du^i}C(u) & = \sum_{i=0}^{n} \frac{d^i}{du^i} N_{i,p}(u)P_i
-     * \f}
-     * for i ranging between 0 and order.
-     *
-     * \param u Parameter \f$u \in [0;1]\f$ at which the spline derivative is evaluated.
-     * \param order The order up to which the derivatives are computed.
-     **/
-    typename SplineTraits<Spline>::DerivativeType
-      derivatives(Scalar u, DenseIndex order) const;
-
-    /**
-     * \copydoc Spline::derivatives
-     * Using the template version of this function is more efficieent since
-     * temporary objects are allocated on the stack whenever this is possible.
-     **/    
-    template <int DerivativeOrder>
-    typename SplineTraits<Spline,DerivativeOrder>::DerivativeType
-      derivatives(Scalar u, DenseIndex order = DerivativeOrder) const;
-
-    /**
-     * \brief Computes the non-zero basis functions at the given site.
-     *
-     * Splines have local support and a point from their image is defined
-     * by exactly \f$p+1\f$ control points \f$P_i\f$ where \f$p\f$ is the
-     * spline degree.
-     *
-     * This function computes the \f$p+1\f$ non-zero basis function values
-     * for a given parameter value \f$u\f$. It returns
-     * \f{align*}{
-     *   N_{i,p}(u), \hdots, N_{i+p+1,p}(u)
-     * \f}
-     *
-     * \param u Parameter \f$u \in [0;1]\f$ at which the non-zero basis functions 
-     *          are computed.
-     **/
-    typename SplineTraits<Spline>::BasisVectorType
-      basisFunctions(Scalar u) const;
-
-    /**
-     * \brief Computes the non-zero spline basis function derivatives up to given order.
-     *
-     * The function computes
-     * \f{align*}{
-     *   \frac{d^i}{du^i} N_{i,p}(u), \hdots, \frac{d^i}{du^i} N_{i+p+1,p}(u)
-     * \f}
-     * with i ranging from 0 up to the specified order.
-     *
-     * \param u Parameter \f$u \in [0;1]\f$ at which the non-zero basis function
-     *          derivatives are computed.
-     * \param order The order up to which the basis function derivatives are computes.
-     **/
-    typename SplineTraits<Spline>::BasisDerivativeType
-      basisFunctionDerivatives(Scalar u, DenseIndex order) const;
-
-    /**
-     * \copydoc Spline::basisFunctionDerivatives
-     * Using the template version of this function is more efficieent since
-     * temporary objects are allocated on the stack whenever this is possible.
-     **/    
-    template <int DerivativeOrder>
-    typename SplineTraits<Spline,DerivativeOrder>::BasisDerivativeType
-      basisFunctionDerivatives(Scalar u, DenseIndex order = DerivativeOrder) const;
-
-    /**
-     * \brief Returns the spline degree.
-     **/ 
-    DenseIndex degree() const;
-
-    /** 
-     * \brief Returns the span within the knot vector in which u is falling.
-     * \param u The site for which the span is determined.
-     **/
-    DenseIndex span(Scalar u) const;
-
-    /**
-     * \brief Computes the span within the provided knot vector in which u is falling.
-     **/
-    static DenseIndex Span(typename SplineTraits<Spline>::Scalar u, DenseIndex degree, const typename SplineTraits<Spline>::KnotVectorType& knots);
-    
-    /**
-     * \brief Returns the spline's non-zero basis functions.
-     *
-     * The function computes and returns
-     * \f{align*}{
-     *   N_{i,p}(u), \hdots, N_{i+p+1,p}(u)
-     * \f}
-     *
-     * \param u The site at which the basis functions are computed.
-     * \param degree The degree of the underlying spline.
-     * \param knots The underlying spline's knot vector.
-     **/
-    static BasisVectorType BasisFunctions(Scalar u, DenseIndex degree, const KnotVectorType& knots);
-
-    /**
-     * \copydoc Spline::basisFunctionDerivatives
-     * \param degree The degree of the underlying spline
-     * \param knots The underlying spline's knot vector.
-     **/    
-    static BasisDerivativeType BasisFunctionDerivatives(
-      const Scalar u, const DenseIndex order, const DenseIndex degree, const KnotVectorType& knots);
-
-  private:
-    KnotVectorType m_knots; /*!< Knot vector. */
-    ControlPointVectorType  m_ctrls; /*!< Control points. */
-
-    template <typename DerivativeType>
-    static void BasisFunctionDerivativesImpl(
-      const typename Spline<Scalar_, Dim_, _Degree>::Scalar u,
-      const DenseIndex order,
-      const DenseIndex p, 
-      const typename Spline<Scalar_, Dim_, _Degree>::KnotVectorType& U,
-      DerivativeType& N_);
-  };
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  DenseIndex Spline<Scalar_, Dim_, _Degree>::Span(
-    typename SplineTraits< Spline<Scalar_, Dim_, _Degree> >::Scalar u,
-    DenseIndex degree,
-    const typename SplineTraits< Spline<Scalar_, Dim_, _Degree> >::KnotVectorType& knots)
-  {
-    // Piegl & Tiller, "The NURBS Book", A2.1 (p. 68)
-    if (u <= knots(0)) return degree;
-    const Scalar* pos = std::upper_bound(knots.data()+degree-1, knots.data()+knots.size()-degree-1, u);
-    return static_cast<DenseIndex>( std::distance(knots.data(), pos) - 1 );
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  typename Spline<Scalar_, Dim_, _Degree>::BasisVectorType
-    Spline<Scalar_, Dim_, _Degree>::BasisFunctions(
-    typename Spline<Scalar_, Dim_, _Degree>::Scalar u,
-    DenseIndex degree,
-    const typename Spline<Scalar_, Dim_, _Degree>::KnotVectorType& knots)
-  {
-    const DenseIndex p = degree;
-    const DenseIndex i = Spline::Span(u, degree, knots);
-
-    const KnotVectorType& U = knots;
-
-    BasisVectorType left(p+1); left(0) = Scalar(0);
-    BasisVectorType right(p+1); right(0) = Scalar(0);
-
-    VectorBlock<BasisVectorType,Degree>(left,1,p) = u - VectorBlock<const KnotVectorType,Degree>(U,i+1-p,p).reverse();
-    VectorBlock<BasisVectorType,Degree>(right,1,p) = VectorBlock<const KnotVectorType,Degree>(U,i+1,p) - u;
-
-    BasisVectorType N(1,p+1);
-    N(0) = Scalar(1);
-    for (DenseIndex j=1; j<=p; ++j)
-    {
-      Scalar saved = Scalar(0);
-      for (DenseIndex r=0; r<j; r++)
-      {
-        const Scalar tmp = N(r)/(right(r+1)+left(j-r));
-        N[r] = saved + right(r+1)*tmp;
-        saved = left(j-r)*tmp;
-      }
-      N(j) = saved;
-    }
-    return N;
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  DenseIndex Spline<Scalar_, Dim_, _Degree>::degree() const
-  {
-    if (_Degree == Dynamic)
-      return m_knots.size() - m_ctrls.cols() - 1;
-    else
-      return _Degree;
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  DenseIndex Spline<Scalar_, Dim_, _Degree>::span(Scalar u) const
-  {
-    return Spline::Span(u, degree(), knots());
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  typename Spline<Scalar_, Dim_, _Degree>::PointType Spline<Scalar_, Dim_, _Degree>::operator()(Scalar u) const
-  {
-    enum { Order = SplineTraits<Spline>::OrderAtCompileTime };
-
-    const DenseIndex span = this->span(u);
-    const DenseIndex p = degree();
-    const BasisVectorType basis_funcs = basisFunctions(u);
-
-    const Replicate<BasisVectorType,Dimension,1> ctrl_weights(basis_funcs);
-    const Block<const ControlPointVectorType,Dimension,Order> ctrl_pts(ctrls(),0,span-p,Dimension,p+1);
-    return (ctrl_weights * ctrl_pts).rowwise().sum();
-  }
-
-  /* --------------------------------------------------------------------------------------------- */
-
-  template <typename SplineType, typename DerivativeType>
-  void derivativesImpl(const SplineType& spline, typename SplineType::Scalar u, DenseIndex order, DerivativeType& der)
-  {    
-    enum { Dimension = SplineTraits<SplineType>::Dimension };
-    enum { Order = SplineTraits<SplineType>::OrderAtCompileTime };
-    enum { DerivativeOrder = DerivativeType::ColsAtCompileTime };
-
-    typedef typename SplineTraits<SplineType>::ControlPointVectorType ControlPointVectorType;
-    typedef typename SplineTraits<SplineType,DerivativeOrder>::BasisDerivativeType BasisDerivativeType;
-    typedef typename BasisDerivativeType::ConstRowXpr BasisDerivativeRowXpr;    
-
-    const DenseIndex p = spline.degree();
-    const DenseIndex span = spline.span(u);
-
-    const DenseIndex n = (std::min)(p, order);
-
-    der.resize(Dimension,n+1);
-
-    // Retrieve the basis function derivatives up to the desired order...    
-    const BasisDerivativeType basis_func_ders = spline.template basisFunctionDerivatives<DerivativeOrder>(u, n+1);
-
-    // ... and perform the linear combinations of the control points.
-    for (DenseIndex der_order=0; der_order<n+1; ++der_order)
-    {
-      const Replicate<BasisDerivativeRowXpr,Dimension,1> ctrl_weights( basis_func_ders.row(der_order) );
-      const Block<const ControlPointVectorType,Dimension,Order> ctrl_pts(spline.ctrls(),0,span-p,Dimension,p+1);
-      der.col(der_order) = (ctrl_weights * ctrl_pts).rowwise().sum();
-    }
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  typename SplineTraits< Spline<Scalar_, Dim_, _Degree> >::DerivativeType
-    Spline<Scalar_, Dim_, _Degree>::derivatives(Scalar u, DenseIndex order) const
-  {
-    typename SplineTraits< Spline >::DerivativeType res;
-    derivativesImpl(*this, u, order, res);
-    return res;
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  template <int DerivativeOrder>
-  typename SplineTraits< Spline<Scalar_, Dim_, _Degree>, DerivativeOrder >::DerivativeType
-    Spline<Scalar_, Dim_, _Degree>::derivatives(Scalar u, DenseIndex order) const
-  {
-    typename SplineTraits< Spline, DerivativeOrder >::DerivativeType res;
-    derivativesImpl(*this, u, order, res);
-    return res;
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  typename SplineTraits< Spline<Scalar_, Dim_, _Degree> >::BasisVectorType
-    Spline<Scalar_, Dim_, _Degree>::basisFunctions(Scalar u) const
-  {
-    return Spline::BasisFunctions(u, degree(), knots());
-  }
-
-  /* --------------------------------------------------------------------------------------------- */
-  
-  
-  template <typename Scalar_, int Dim_, int _Degree>
-  template <typename DerivativeType>
-  void Spline<Scalar_, Dim_, _Degree>::BasisFunctionDerivativesImpl(
-    const typename Spline<Scalar_, Dim_, _Degree>::Scalar u,
-    const DenseIndex order,
-    const DenseIndex p, 
-    const typename Spline<Scalar_, Dim_, _Degree>::KnotVectorType& U,
-    DerivativeType& N_)
-  {
-    typedef Spline<Scalar_, Dim_, _Degree> SplineType;
-    enum { Order = SplineTraits<SplineType>::OrderAtCompileTime };
-
-    const DenseIndex span = SplineType::Span(u, p, U);
-
-    const DenseIndex n = (std::min)(p, order);
-
-    N_.resize(n+1, p+1);
-
-    BasisVectorType left = BasisVectorType::Zero(p+1);
-    BasisVectorType right = BasisVectorType::Zero(p+1);
-
-    Matrix<Scalar,Order,Order> ndu(p+1,p+1);
-
-    Scalar saved, temp; // FIXME These were double instead of Scalar. Was there a reason for that?
-
-    ndu(0,0) = 1.0;
-
-    DenseIndex j;
-    for (j=1; j<=p; ++j)
-    {
-      left[j] = u-U[span+1-j];
-      right[j] = U[span+j]-u;
-      saved = 0.0;
-
-      for (DenseIndex r=0; r<j; ++r)
-      {
-        /* Lower triangle */
-        ndu(j,r) = right[r+1]+left[j-r];
-        temp = ndu(r,j-1)/ndu(j,r);
-        /* Upper triangle */
-        ndu(r,j) = static_cast<Scalar>(saved+right[r+1] * temp);
-        saved = left[j-r] * temp;
-      }
-
-      ndu(j,j) = static_cast<Scalar>(saved);
-    }
-
-    for (j = p; j>=0; --j) 
-      N_(0,j) = ndu(j,p);
-
-    // Compute the derivatives
-    DerivativeType a(n+1,p+1);
-    DenseIndex r=0;
-    for (; r<=p; ++r)
-    {
-      DenseIndex s1,s2;
-      s1 = 0; s2 = 1; // alternate rows in array a
-      a(0,0) = 1.0;
-
-      // Compute the k-th derivative
-      for (DenseIndex k=1; k<=static_cast<DenseIndex>(n); ++k)
-      {
-        Scalar d = 0.0;
-        DenseIndex rk,pk,j1,j2;
-        rk = r-k; pk = p-k;
-
-        if (r>=k)
-        {
-          a(s2,0) = a(s1,0)/ndu(pk+1,rk);
-          d = a(s2,0)*ndu(rk,pk);
-        }
-
-        if (rk>=-1) j1 = 1;
-        else        j1 = -rk;
-
-        if (r-1 <= pk) j2 = k-1;
-        else           j2 = p-r;
-
-        for (j=j1; j<=j2; ++j)
-        {
-          a(s2,j) = (a(s1,j)-a(s1,j-1))/ndu(pk+1,rk+j);
-          d += a(s2,j)*ndu(rk+j,pk);
-        }
-
-        if (r<=pk)
-        {
-          a(s2,k) = -a(s1,k-1)/ndu(pk+1,r);
-          d += a(s2,k)*ndu(r,pk);
-        }
-
-        N_(k,r) = static_cast<Scalar>(d);
-        j = s1; s1 = s2; s2 = j; // Switch rows
-      }
-    }
-
-    /* Multiply through by the correct factors */
-    /* (Eq. [2.9])                             */
-    r = p;
-    for (DenseIndex k=1; k<=static_cast<DenseIndex>(n); ++k)
-    {
-      for (j=p; j>=0; --j) N_(k,j) *= r;
-      r *= p-k;
-    }
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  typename SplineTraits< Spline<Scalar_, Dim_, _Degree> >::BasisDerivativeType
-    Spline<Scalar_, Dim_, _Degree>::basisFunctionDerivatives(Scalar u, DenseIndex order) const
-  {
-    typename SplineTraits<Spline<Scalar_, Dim_, _Degree> >::BasisDerivativeType der;
-    BasisFunctionDerivativesImpl(u, order, degree(), knots(), der);
-    return der;
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  template <int DerivativeOrder>
-  typename SplineTraits< Spline<Scalar_, Dim_, _Degree>, DerivativeOrder >::BasisDerivativeType
-    Spline<Scalar_, Dim_, _Degree>::basisFunctionDerivatives(Scalar u, DenseIndex order) const
-  {
-    typename SplineTraits< Spline<Scalar_, Dim_, _Degree>, DerivativeOrder >::BasisDerivativeType der;
-    BasisFunctionDerivativesImpl(u, order, degree(), knots(), der);
-    return der;
-  }
-
-  template <typename Scalar_, int Dim_, int _Degree>
-  typename SplineTraits<Spline<Scalar_, Dim_, _Degree> >::BasisDerivativeType
-  Spline<Scalar_, Dim_, _Degree>::BasisFunctionDerivatives(
-    const typename Spline<Scalar_, Dim_, _Degree>::Scalar u,
-    const DenseIndex order,
-    const DenseIndex degree,
-    const typename Spline<Scalar_, Dim_, _Degree>::KnotVectorType& knots)
-  {
-    typename SplineTraits<Spline>::BasisDerivativeType der;
-    BasisFunctionDerivativesImpl(u, order, degree, knots, der);
-    return der;
-  }
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "graph.h"
+
+/* Curve smoothing : uniform B-splines of fixed degree */
+namespace pa {
+
+	namespace detail {
+		constexpr double binomial(int n, int k) {
+			double r = 1.0;
+			for (int i = 1; i <= k; i++) r = r * (n - k + i) / i;
+			return r;
+		}
+
+		constexpr double power(double x, int n) {
+			double r = 1.0;
+			for (int i = 0; i < n; i++) r *= x;
+			return r;
+		}
+	}
+
+	// Uniform B-spline basis of degree D on one segment : basis k, weighting control point k
+	// of the segment, is sum_j m[k][j] t^j for t in [0, 1].
+	template<size_t Degree>
+	constexpr std::array<std::array<float, Degree + 1>, Degree + 1> uniformBSplineBasis() {
+		std::array<std::array<float, Degree + 1>, Degree + 1> m{};
+		constexpr int d = static_cast<int>(Degree);
+		double factorial = 1.0;
+		for (int i = 2; i <= d; i++) factorial *= i;
+		for (int k = 0; k <= d; k++) {
+			for (int j = 0; j <= d; j++) {
+				double sum = 0.0;
+				for (int s = k; s <= d; s++) {
+					double term = detail::binomial(d + 1, s - k) * detail::power(d - s, d - j);
+					sum += (s - k) % 2 ? -term : term;
+				}
+				m[static_cast<size_t>(k)][static_cast<size_t>(j)] = static_cast<float>(detail::binomial(d, j) * sum / factorial);
+			}
+		}
+		return m;
+	}
+
+	// Curves flattened to polylines. Polyline i is points offsets[i] .. offsets[i+1].
+	// Reused from a flattening to the next, so that it does not reallocate.
+	struct Polylines {
+		std::vector<uint32_t> offsets{ 0 };
+		std::vector<Point> points;
+
+		size_t size() const { return offsets.size() - 1; }
+		void clear() {
+			offsets.assign(1, 0);
+			points.clear();
+		}
+	};
+
+	// Evaluates count polynomials of order coefficients at t, coefs[j][s] being the coefficient
+	// of t^j of polynomial s. With SSE/AVX when available, same floats on every path.
+	void evaluatePolynomials(const float* const* coefs, int order, size_t count, float t, float* out);
+
+	// Uniform B-spline curves of fixed degree, cut in polynomial segments. Coefficients are
+	// stored as structure of arrays, coefficient j of all the segments being contiguous, so that
+	// the segments of many curves are evaluated at once.
+	template<size_t Degree>
+	class BSpline {
+		static_assert(Degree >= 1, "B-splines are at least linear");
+
+	public:
+		static constexpr size_t degree = Degree;
+		static constexpr size_t order = Degree + 1;
+		static constexpr std::array<std::array<float, order>, order> basis = uniformBSplineBasis<Degree>();
+
+	private:
+		// coefficient of t^j of segment s in m_x[j][s], m_y[j][s]
+		std::array<std::vector<float>, order> m_x;
+		std::array<std::vector<float>, order> m_y;
+
+		// first segment of each appended control polygon, then the end
+		std::vector<size_t> m_curves{ 0 };
+
+		// segments evaluated together for all the parameters, their coefficients staying in cache
+		static constexpr size_t block = 512;
+
+		// most parts flatten cuts a segment into, against overflow on degenerate input
+		static constexpr int max_parts = 1 << 16;
+
+		std::array<const float*, order> pointers(const std::array<std::vector<float>, order>& c, size_t first) const {
+			std::array<const float*, order> p;
+			for (size_t j = 0; j < order; j++) p[j] = c[j].data() + first;
+			return p;
+		}
+
+	public:
+		size_t size() const { return m_x[0].size(); }
+		size_t curveCount() const { return m_curves.size() - 1; }
+		// segments of curve c are firstSegment(c) .. firstSegment(c + 1)
+		size_t firstSegment(size_t c) const { return m_curves[c]; }
+
+		void clear() {
+			for (size_t j = 0; j < order; j++) {
+				m_x[j].clear();
+				m_y[j].clear();
+			}
+			m_curves.assign(1, 0);
+		}
+
+		// Appends the segments of a control polygon of n points : n - Degree of them
+		// if open, n if closed (the polygon wraps around). Returns the first one.
+		size_t append(const Point* control, size_t n, bool closed) {
+			size_t first = size();
+			size_t segments = closed ? n : (n > Degree ? n - Degree : 0);
+			for (size_t s = 0; s < segments; s++) {
+				for (size_t j = 0; j < order; j++) {
+					float x = 0.0f, y = 0.0f;
+					for (size_t k = 0; k < order; k++) {
+						const Point& p = control[(s + k) % n];
+						x += basis[k][j] * p.x;
+						y += basis[k][j] * p.y;
+					}
+					m_x[j].push_back(x);
+					m_y[j].push_back(y);
+				}
+			}
+			m_curves.push_back(size());
+			return first;
+		}
+
+		// Point of segment s at t, same as evaluate
+		Point operator()(size_t s, float t) const {
+			float x = m_x[Degree][s], y = m_y[Degree][s];
+			for (size_t j = Degree; j-- > 0;) {
+				x = x * t + m_x[j][s];
+				y = y * t + m_y[j][s];
+			}
+			return Point(x, y);
+		}
+
+		// Tangent of segment s at t
+		Point derivative(size_t s, float t) const {
+			float x = static_cast<float>(Degree) * m_x[Degree][s], y = static_cast<float>(Degree) * m_y[Degree][s];
+			for (size_t j = Degree - 1; j >= 1; j--) {
+				x = x * t + static_cast<float>(j) * m_x[j][s];
+				y = y * t + static_cast<float>(j) * m_y[j][s];
+			}
+			return Point(x, y);
+		}
+
+		// Second derivative of segment s at t
+		Point secondDerivative(size_t s, float t) const {
+			float x = 0.0f, y = 0.0f;
+			for (size_t j = Degree; j >= 2; j--) {
+				x = x * t + static_cast<float>(j * (j - 1)) * m_x[j][s];
+				y = y * t + static_cast<float>(j * (j - 1)) * m_y[j][s];
+			}
+			return Point(x, y);
+		}
+
+		// Bound of the second derivative norm on segment s. Up to cubics it is linear in t,
+		// so largest at one end.
+		float secondDerivativeBound(size_t s) const {
+			static_assert(Degree <= 3, "second derivative must be linear");
+			Point a = secondDerivative(s, 0.0f), b = secondDerivative(s, 1.0f);
+			return std::sqrt(std::max(a.x * a.x + a.y * a.y, b.x * b.x + b.y * b.y));
+		}
+
+		// Flattens each appended control polygon to a polyline in out, points scaled by scale > 0.
+		// A curve stays within tolerance > 0 (after scaling) of its chord over a parameter
+		// length h if h^2 M / 8 <= tolerance, M bounding its second derivative : chords are
+		// made as long as possible, across segments, and segments too curved on their own
+		// are cut into the least equal parts.
+		void flatten(float scale, float tolerance, Polylines& out) const {
+			assert(scale > 0.0f && tolerance > 0.0f);
+			out.clear();
+			const float limit = 8.0f * tolerance / scale;
+			for (size_t c = 0; c < curveCount(); c++) {
+				size_t first = m_curves[c], last = m_curves[c + 1];
+				if (first != last) {
+					out.points.push_back(scale * (*this)(first, 0.0f));
+					// parameter length since last point, and second derivative bound on it
+					float h = 0.0f, bound = 0.0f;
+					for (size_t s = first; s < last; s++) {
+						float m = secondDerivativeBound(s);
+						float grown = std::max(bound, m);
+						if ((h + 1.0f) * (h + 1.0f) * grown <= limit) {
+							h += 1.0f;
+							bound = grown;
+							continue;
+						}
+						if (h > 0.0f)
+							out.points.push_back(scale * (*this)(s, 0.0f));
+						// written so that a NaN or infinite count gives max_parts
+						float count = std::ceil(std::sqrt(m / limit));
+						int parts = count < static_cast<float>(max_parts) ? std::max(1, static_cast<int>(count)) : max_parts;
+						for (int i = 1; i < parts; i++)
+							out.points.push_back(scale * (*this)(s, static_cast<float>(i) / static_cast<float>(parts)));
+						h = 1.0f / static_cast<float>(parts);
+						bound = m;
+					}
+					out.points.push_back(scale * (*this)(last - 1, 1.0f));
+				}
+				out.offsets.push_back(static_cast<uint32_t>(out.points.size()));
+			}
+		}
+
+		// Points of all the segments at t, segment s in x[s], y[s]
+		void evaluate(float t, float* x, float* y) const {
+			evaluate(&t, 1, x, y);
+		}
+
+		// Points of all the segments at ts[0] .. ts[count-1], point i of segment s
+		// in x[i * size() + s], y[i * size() + s]
+		void evaluate(const float* ts, size_t count, float* x, float* y) const {
+			for (size_t first = 0; first < size(); first += block) {
+				size_t segments = std::min(block, size() - first);
+				auto cx = pointers(m_x, first);
+				auto cy = pointers(m_y, first);
+				for (size_t i = 0; i < count; i++) {
+					evaluatePolynomials(cx.data(), static_cast<int>(order), segments, ts[i], x + i * size() + first);
+					evaluatePolynomials(cy.data(), static_cast<int>(order), segments, ts[i], y + i * size() + first);
+				}
+			}
+		}
+	};
+
+	using QuadraticBSpline = BSpline<2>;
+	using CubicBSpline = BSpline<3>;
 }
-
-#endif // EIGEN_SPLINE_H
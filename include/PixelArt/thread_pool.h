@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pa {
+
+	// Fixed set of worker threads running parallel loops.
+	// Calling thread takes part in the work, so a pool of 1 thread runs everything inline.
+	class ThreadPool {
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_mutex;
+		std::condition_variable m_start;
+		std::condition_variable m_done;
+
+		// current loop
+		const std::function<void(size_t)>* m_job;
+		size_t m_count;
+		std::atomic<size_t> m_next;
+		size_t m_busy; // workers still in current loop
+		size_t m_generation; // incremented for each new loop
+		bool m_stop;
+
+		// grab and run indices of current loop until none left
+		void work();
+		void workerLoop();
+
+	public:
+		// threads = 0 : one thread per core
+		explicit ThreadPool(unsigned threads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// number of threads, calling one included
+		size_t size() const { return m_workers.size() + 1; }
+
+		// Calls f(i) for 0 <= i < count, in any order and thread. Returns when all calls are done.
+		void parallel_for(size_t count, const std::function<void(size_t)>& f);
+	};
+}
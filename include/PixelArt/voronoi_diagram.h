@@ -3,30 +3,135 @@
 #include <unordered_map>
 #include <iostream>
 #include <PixelArt/pixel_graph.h>
+#include <PixelArt/thread_pool.h>
 
 /* Strategy :
 * Constructing cell : easy heuristic, just check connected neighbouring nodes
 * Collapsing 2-valence nodes : std::unordered_map, same on memory, constant access time, 
 * no need to aprcours it and we prefer accessing element by its position in grid. 
 * 
-* Computing on beginning of program through static varibale all possible cell variations.
+* All possible cell variations are computed at compile time.
 
 */
 
 namespace pa {
 
 	// Some types
-	using voronoiCell = std::vector<Point>;
 	using voronoiCellType = uint8_t; // 8 bits
 
-	using diagram = std::unordered_map<Point, std::vector<Point>>;
+	// Cell vertex as quarter pixel offset from the pixel's top left corner
+	struct LatticeOffset {
+		int8_t x;
+		int8_t y;
+	};
+
+	// Voronoi cell, at most 2 points per corner and the 4 mid-points
+	struct LatticeCell {
+		static constexpr int capacity = 12;
+
+		std::array<LatticeOffset, capacity> points;
+		uint8_t size;
+
+		constexpr void push(int x, int y) {
+			points[size++] = LatticeOffset{ int8_t(x), int8_t(y) };
+		}
+	};
+
+	// Translates cell to pixel (x,y), writing its points to out. Returns the point count.
+	inline int expandCell(const LatticeCell& cell, int x, int y, LatticePoint* out) {
+		for (size_t i = 0; i < cell.size; i++)
+			out[i] = lattice_point(4 * x + cell.points[i].x, 4 * y + cell.points[i].y);
+		return cell.size;
+	}
+
+	// Simplified diagram as a half-edge mesh, one face per pixel.
+	// Face f is the cell of pixel (f / height, f % height). Its half-edges are
+	// face_offsets[f] .. face_offsets[f+1] in cell order, half-edge e going from
+	// vertex origin[e] to target(e). Vertices are lattice points, see to_point.
+	struct VoronoiMesh {
+		static constexpr uint32_t none = UINT32_MAX;
+
+		std::vector<LatticePoint> vertices;
+		std::vector<uint32_t> face_offsets;
+		// per half-edge
+		std::vector<uint32_t> origin;
+		std::vector<uint32_t> face;
+		std::vector<uint32_t> twin; // same edge in the neighbouring face, none if unmatched
+		unsigned height = 0;
+
+		size_t faceCount() const { return face_offsets.empty() ? 0 : face_offsets.size() - 1; }
+		size_t halfEdgeCount() const { return origin.size(); }
+		IntPoint pixel(uint32_t f) const { return IntPoint(static_cast<int>(f / height), static_cast<int>(f % height)); }
+
+		uint32_t next(uint32_t e) const {
+			return e + 1 < face_offsets[face[e] + 1] ? e + 1 : face_offsets[face[e]];
+		}
+		uint32_t target(uint32_t e) const { return origin[next(e)]; }
+
+		void clear();
+	};
+
+	// Connected regions of the similarity graph, each the union of the cells of its pixels.
+	// Regions are numbered in order of their first pixel. Loops of region r are
+	// region_offsets[r] .. region_offsets[r+1], and loop l is made of the mesh vertices
+	// loop_offsets[l] .. loop_offsets[l+1]. Points where inner edges met are kept.
+	// Loops turning like the cells add to the region, the first one being on its outer
+	// boundary, loops turning the other way round are holes. Where a region touches itself
+	// at a point its boundary may be split there, but the winding number stays 1 inside
+	// the region and 0 outside.
+	struct RegionPolygons {
+		std::vector<uint32_t> face_region;
+		std::vector<sf::Color> colors; // of the first pixel
+		std::vector<uint32_t> region_offsets;
+		std::vector<uint32_t> loop_offsets;
+		std::vector<uint32_t> vertices;
+
+		size_t regionCount() const { return colors.size(); }
+		size_t loopCount() const { return loop_offsets.empty() ? 0 : loop_offsets.size() - 1; }
+
+		void clear();
+	};
+
+	// Edge between two pixels of different colors. colors[0] is the color of
+	// the pixel first in column major order.
+	struct ActiveEdge {
+		EdgeId id;
+		uint32_t half_edge; // in the face of colors[0]
+		std::array<sf::Color, 2> colors;
+		uint8_t v; // Visibility
+
+		Edge edge() const { return Edge::fromId(id); }
+	};
+
+	// Active edges, stored densely in pixel order and found by id through
+	// an open addressing index.
+	class ActiveEdgeList {
+		std::vector<ActiveEdge> m_edges;
+		std::vector<uint32_t> m_index; // power of 2 size, slots of none are empty
+		static constexpr uint32_t none = UINT32_MAX;
+
+		size_t slot(EdgeId id) const {
+			return (id * 0x9E3779B97F4A7C15ull) >> 32 & (m_index.size() - 1);
+		}
+
+	public:
+		using const_iterator = std::vector<ActiveEdge>::const_iterator;
+
+		const_iterator begin() const { return m_edges.begin(); }
+		const_iterator end() const { return m_edges.end(); }
+		size_t size() const { return m_edges.size(); }
+		bool empty() const { return m_edges.empty(); }
+		const ActiveEdge& operator[](size_t i) const { return m_edges[i]; }
+
+		// nullptr if the edge is not active
+		const ActiveEdge* find(EdgeId id) const;
 
-	struct EdgeProperties {
-		std::vector<sf::Color> colors;
-		Visibility v;
+		// takes edges of distinct ids and builds the index
+		void assign(std::vector<ActiveEdge>&& edges);
+		void clear();
 	};
 
-	using edge_list = std::unordered_map<Edge, EdgeProperties>;
+	using edge_list = ActiveEdgeList;
 
 
 	// Going in this fashion :
@@ -51,33 +156,26 @@ namespace pa {
 	static std::array<Direction, 2> edges_parcours{BOTTOM_RIGHT, TOP_RIGHT};
 
 #define TOTAL_VORONOI_CELLS 256
-	using possible_cells_list = std::array<voronoiCell, TOTAL_VORONOI_CELLS>;
-
-	// Checks if cell type can be in similarity graph
-	bool checkCellType(voronoiCellType type);
-
-
-	// static struct will let us laucnh initial calculation on the first instantiation of the
-	// Voronoi Diagram class. It will calculate all 81 possible cells and store them.
-	struct CellsCalculation {
+	using possible_cells_list = std::array<LatticeCell, TOTAL_VORONOI_CELLS>;
+
+	// Image borders a pixel lies on, they decide the valence of its outer points
+	enum CellBorder : uint8_t {
+		BORDER_LEFT = 1,
+		BORDER_TOP = 2,
+		BORDER_RIGHT = 4,
+		BORDER_BOTTOM = 8
+	};
 
-		possible_cells_list possibleCells;
+	// Simplified cells are keyed by cell type and borders
+#define TOTAL_SIMPLIFIED_CELLS (TOTAL_VORONOI_CELLS << 4)
+	using simplified_cells_list = std::array<LatticeCell, TOTAL_SIMPLIFIED_CELLS>;
 
-		// We can see on the algorithm that we have 3^4 combinations possible
-		// for voronoi cell generation. If we want to generate all 2 valence possible
-		// cimbinations, we have (3^4)^8=3^32 (8 adjacent cells) that is too much.
-		// so only generating Cell by type then 2-valence reduction.
-		voronoiCell generateCellByType(voronoiCellType type);
+	constexpr size_t simplifiedCellKey(voronoiCellType type, uint8_t border) {
+		return type | border << 8;
+	}
 
-		void generateAllCellTypes();
-	public:
-		CellsCalculation() {
-			generateAllCellTypes();
-		}
-		~CellsCalculation() {
-			
-		}
-	};
+	// Checks if cell type can be in similarity graph
+	bool checkCellType(voronoiCellType type);
 
 
 	// Usage : will take a PixelGraph, extract its internal graph and then do all the calculations
@@ -87,43 +185,68 @@ namespace pa {
 	// - an edge list which contains all active edges as defined by the parameters given on VoronoiDiagram construction,
 	// or set later on.
 	class VoronoiDiagram {
-		// Store each voronoiCell possible configurations 2^8
-		// In reality 3^4 since no crossing but well
-		static CellsCalculation cellsCalculation;
-
 		// initial pixel graph
 		const PixelGraph* m_graph;
 
-		//Voronoi points around each pixels starting from top_left, trigonometric parcours
-		std::vector<std::vector<voronoiCell>> m_voronoiPoints;
+		// Final diagram
+		VoronoiMesh m_mesh;
 
-		// Valency of each voronoi point for collapsing
-		std::unordered_map<Point, int> m_valency;
+		// While building, released by compute : lattice point of each half-edge origin, and
+		// the first half-edge leaving the same point, which numbers the vertices.
+		std::vector<LatticePoint> m_points;
+		std::vector<uint32_t> m_first_edge;
 
-		// Final diagram
-		diagram m_diagram;
+		// Outgoing half-edges of each vertex, a vertex is in 4 cells at most
+		std::vector<std::array<uint32_t, 4>> m_out_edges;
 
 		// active edges
 		edge_list m_active_edges;
 
+		// regions of similar pixels
+		RegionPolygons m_regions;
+
 		// Functor for edge decision
 		ImageOp<TestEdgeVisibility> m_test_visibility;
 
-		// Determine cell type on point p
-		voronoiCellType extractType(const IntPoint& p) const;
+		// Functor results between palette colors, if graph is in palette mode
+		PaletteTable<2> m_visibility_table;
 
-		// Calling this function over the whole voronoi diagram will
-		// determine the active edges 
-		void checkAndAddActiveEdge(Point& pa, Point& pb, int x, int y);
+		// first half-edge of the faces of column x
+		uint32_t columnStart(int x) const {
+			return m_mesh.face_offsets[static_cast<size_t>(x) * m_mesh.height];
+		}
 
-		// generate diagram without valence 2 reduction
-		void generateAccurateDiagram();
+		// Each stage works on the pixel columns x0 <= x < x1, and may run at the same
+		// time on other columns. Cells only share points with the columns next to them.
 
-		// valence 2 reduction and additional calculation to determine active edges
-		void simplifyDiagram();
+		// Cells come from the cell types of the graph. Size of the simplified cells,
+		// then their points.
+		void countCellPoints(int x0, int x1);
+		void expandCells(int x0, int x1);
 
-		// Called remove Edges calssified as None.
-		void deleteNonActiveEdges();
+		// first half-edge leaving the origin of each half-edge. It is in the earliest face
+		// holding the point, which is the face itself or one of its neighbours before it.
+		void findFirstEdges(int x0, int x1);
+
+		// number the vertices from id in order of first appearance, and set half-edge origins
+		uint32_t countVertices(int x0, int x1) const;
+		void numberVertices(int x0, int x1, uint32_t id);
+		void setOrigins(int x0, int x1);
+
+		// Match each half-edge with the reversed one of the neighbouring face.
+		// listOutEdges is not to run at the same time on neighbouring columns.
+		void listOutEdges(int x0, int x1);
+		void linkTwins(int x0, int x1);
+
+		// Edges shared by two faces of visible different colors, the first face in pixel order giving colors[0]
+		void findActiveEdges(int x0, int x1, std::vector<ActiveEdge>& found) const;
+
+		// Label the faces with their region, then walk the half-edges between regions
+		void labelRegions();
+		void traceRegions();
+		bool isRegionBoundary(uint32_t e) const;
+		// next half-edge of the boundary after e, turning around the target of e
+		uint32_t nextRegionBoundary(uint32_t e) const;
 
 	public:
 		// Constructor
@@ -136,13 +259,17 @@ namespace pa {
 		void setParam(const EdgeDissimilarityParam& p);
 
 		// Computes simplfiied voronoi diagram and determines active edges.
-		void compute();
+		// threads : 1 for serial, 0 for one thread per core. Result does not depend on it.
+		void compute(unsigned threads = 1);
 
 		// get computed diagram
-		const diagram& getDiagram();
+		const VoronoiMesh& getDiagram() const;
 
 		// get computed list of active edges
-		const edge_list& getActiveEdges();
+		const edge_list& getActiveEdges() const;
+
+		// get computed polygons of the regions of similar pixels
+		const RegionPolygons& getRegions() const;
 
 		// get underlying graph
 		const PixelGraph* getGraph() { return m_graph; };
@@ -0,0 +1,154 @@
+#include <PixelArt/curves.h>
+#include <cmath>
+#include <numeric>
+
+namespace pa {
+
+	void CurveList::clear() {
+		offsets.clear();
+		vertices.clear();
+		edges.clear();
+		closed.clear();
+	}
+
+
+	CurveExtractor::CurveExtractor() : m_diagram(nullptr) {
+	}
+
+	void CurveExtractor::setDiagram(const VoronoiDiagram& diagram) {
+		m_diagram = &diagram;
+	}
+
+	uint32_t CurveExtractor::vertex(uint32_t incidence) const {
+		const VoronoiMesh& mesh = m_diagram->getDiagram();
+		uint32_t e = m_diagram->getActiveEdges()[incidence >> 1].half_edge;
+		return (incidence & 1) ? mesh.target(e) : mesh.origin[e];
+	}
+
+	void CurveExtractor::buildAdjacency() {
+		uint32_t incidences = static_cast<uint32_t>(2 * m_diagram->getActiveEdges().size());
+		m_local.assign(m_diagram->getDiagram().vertices.size(), VoronoiMesh::none);
+		m_vertices.clear();
+		m_adjacency_offsets.assign(1, 0);
+		for (uint32_t i = 0; i < incidences; i++) {
+			uint32_t& local = m_local[vertex(i)];
+			if (local == VoronoiMesh::none) {
+				local = static_cast<uint32_t>(m_vertices.size());
+				m_vertices.push_back(vertex(i));
+				m_adjacency_offsets.push_back(0);
+			}
+			m_adjacency_offsets[local + 1]++;
+		}
+		std::partial_sum(m_adjacency_offsets.begin(), m_adjacency_offsets.end(), m_adjacency_offsets.begin());
+
+		std::vector<uint32_t> slot(m_adjacency_offsets.begin(), m_adjacency_offsets.end() - 1);
+		m_adjacency.resize(incidences);
+		for (uint32_t i = 0; i < incidences; i++)
+			m_adjacency[slot[m_local[vertex(i)]]++] = i;
+	}
+
+	void CurveExtractor::joinJunction(const uint32_t* incidences) {
+		const ActiveEdgeList& edges = m_diagram->getActiveEdges();
+		const VoronoiMesh& mesh = m_diagram->getDiagram();
+
+		// the edge left out, if it is the only shading one
+		int shading = 0;
+		size_t alone = 0;
+		for (size_t k = 0; k < 3; k++) {
+			if (edges[incidences[k] >> 1].v == Shading) {
+				shading++;
+				alone = k;
+			}
+		}
+		if (shading != 1) {
+			// else the one left out of the straightest pair
+			std::array<sf::Vector2f, 3> dirs;
+			for (size_t k = 0; k < 3; k++) {
+				LatticePoint from = mesh.vertices[vertex(incidences[k])];
+				LatticePoint to = mesh.vertices[vertex(incidences[k] ^ 1)];
+				dirs[k] = sf::Vector2f(float(lattice_x(to) - lattice_x(from)), float(lattice_y(to) - lattice_y(from)));
+				dirs[k] /= std::sqrt(dirs[k].x * dirs[k].x + dirs[k].y * dirs[k].y);
+			}
+			float best = 2.0f;
+			for (size_t k = 0; k < 3; k++) {
+				const sf::Vector2f& a = dirs[(k + 1) % 3];
+				const sf::Vector2f& b = dirs[(k + 2) % 3];
+				float cosine = a.x * b.x + a.y * b.y;
+				if (cosine < best) {
+					best = cosine;
+					alone = k;
+				}
+			}
+		}
+		uint32_t a = incidences[(alone + 1) % 3];
+		uint32_t b = incidences[(alone + 2) % 3];
+		m_next[a] = b;
+		m_next[b] = a;
+	}
+
+	void CurveExtractor::joinEdges() {
+		m_next.assign(m_adjacency.size(), VoronoiMesh::none);
+		for (size_t v = 0; v < m_vertices.size(); v++) {
+			const uint32_t* incidences = &m_adjacency[m_adjacency_offsets[v]];
+			uint32_t valence = m_adjacency_offsets[v + 1] - m_adjacency_offsets[v];
+			if (valence == 2) {
+				m_next[incidences[0]] = incidences[1];
+				m_next[incidences[1]] = incidences[0];
+			}
+			else if (valence == 3) {
+				joinJunction(incidences);
+			}
+		}
+	}
+
+	void CurveExtractor::traceCurves() {
+		// An incidence i stands for going along edge i / 2 from its side i & 1, a curve
+		// goes on from edge i / 2 with m_next[i ^ 1].
+		uint32_t count = static_cast<uint32_t>(m_diagram->getActiveEdges().size());
+		std::vector<uint8_t> visited(count, 0);
+		m_curves.offsets.assign(1, 0);
+		for (uint32_t a = 0; a < count; a++) {
+			if (visited[a]) continue;
+
+			// go back to the start of the curve, if it is not closed
+			uint32_t start = 2 * a;
+			for (uint32_t back = 2 * a + 1;;) {
+				uint32_t previous = m_next[back ^ 1];
+				if (previous == VoronoiMesh::none) {
+					start = back ^ 1;
+					break;
+				}
+				if ((previous >> 1) == a) break;
+				back = previous;
+			}
+
+			m_curves.vertices.push_back(vertex(start));
+			uint8_t closed = 0;
+			for (uint32_t i = start;;) {
+				visited[i >> 1] = 1;
+				m_curves.edges.push_back(i >> 1);
+				m_curves.vertices.push_back(vertex(i ^ 1));
+				i = m_next[i ^ 1];
+				if (i == VoronoiMesh::none) break;
+				if (i == start) {
+					closed = 1;
+					break;
+				}
+			}
+			m_curves.offsets.push_back(static_cast<uint32_t>(m_curves.vertices.size()));
+			m_curves.closed.push_back(closed);
+		}
+	}
+
+	void CurveExtractor::compute() {
+		m_curves.clear();
+		buildAdjacency();
+		joinEdges();
+		traceCurves();
+	}
+
+	const CurveList& CurveExtractor::getCurves() const {
+		return m_curves;
+	}
+
+}
@@ -0,0 +1,121 @@
+#include <PixelArt/image_op.h>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PA_YUV_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define PA_YUV_SSE2
+#endif
+
+namespace pa {
+
+	// Kernels below compute Y = (0.299 r + 0.587 g) + 0.114 b, then U and V from Y,
+	// in the same order as ColorYUV::convertRGB, so every path gives the same floats.
+
+#if defined(PA_YUV_AVX2)
+	// 8 RGBA pixels per iteration. Returns number of pixels converted.
+	static size_t convertYUVBlock(const sf::Uint8* rgba, size_t count, float* Y, float* U, float* V)
+	{
+		const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+		const __m256 cr = _mm256_set1_ps(0.299f), cg = _mm256_set1_ps(0.587f), cb = _mm256_set1_ps(0.114f);
+		const __m256 cu = _mm256_set1_ps(0.492f), cv = _mm256_set1_ps(0.877f);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + 4 * i));
+			__m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(px, byte_mask));
+			__m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 8), byte_mask));
+			__m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 16), byte_mask));
+			__m256 y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cr, r), _mm256_mul_ps(cg, g)), _mm256_mul_ps(cb, b));
+			_mm256_storeu_ps(Y + i, y);
+			_mm256_storeu_ps(U + i, _mm256_mul_ps(cu, _mm256_sub_ps(b, y)));
+			_mm256_storeu_ps(V + i, _mm256_mul_ps(cv, _mm256_sub_ps(r, y)));
+		}
+		return i;
+	}
+#elif defined(PA_YUV_SSE2)
+	// 4 RGBA pixels per iteration. Returns number of pixels converted.
+	static size_t convertYUVBlock(const sf::Uint8* rgba, size_t count, float* Y, float* U, float* V)
+	{
+		const __m128i byte_mask = _mm_set1_epi32(0xFF);
+		const __m128 cr = _mm_set1_ps(0.299f), cg = _mm_set1_ps(0.587f), cb = _mm_set1_ps(0.114f);
+		const __m128 cu = _mm_set1_ps(0.492f), cv = _mm_set1_ps(0.877f);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 4 * i));
+			__m128 r = _mm_cvtepi32_ps(_mm_and_si128(px, byte_mask));
+			__m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 8), byte_mask));
+			__m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 16), byte_mask));
+			__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cr, r), _mm_mul_ps(cg, g)), _mm_mul_ps(cb, b));
+			_mm_storeu_ps(Y + i, y);
+			_mm_storeu_ps(U + i, _mm_mul_ps(cu, _mm_sub_ps(b, y)));
+			_mm_storeu_ps(V + i, _mm_mul_ps(cv, _mm_sub_ps(r, y)));
+		}
+		return i;
+	}
+#else
+	static size_t convertYUVBlock(const sf::Uint8*, size_t, float*, float*, float*)
+	{
+		return 0;
+	}
+#endif
+
+	void YUVPlanes::convert(const sf::Image& image)
+	{
+		dim = image.getSize();
+		size_t count = static_cast<size_t>(dim.x) * dim.y;
+		Y.resize(count);
+		U.resize(count);
+		V.resize(count);
+		if (!count)
+			return;
+
+		// sf::Image stores RGBA bytes, row after row
+		const sf::Uint8* rgba = image.getPixelsPtr();
+		size_t i = convertYUVBlock(rgba, count, Y.data(), U.data(), V.data());
+
+		// remaining pixels
+		for (; i < count; i++) {
+			ColorYUV c;
+			c.convertRGB(sf::Color(rgba[4 * i], rgba[4 * i + 1], rgba[4 * i + 2]));
+			Y[i] = c.Y;
+			U[i] = c.U;
+			V[i] = c.V;
+		}
+	}
+
+	bool Palette::extract(const sf::Image& image)
+	{
+		dim = image.getSize();
+		colors.clear();
+		indices.resize(static_cast<size_t>(dim.x) * dim.y);
+
+		// colors by their RGBA integer value
+		std::unordered_map<sf::Uint32, uint8_t> known;
+		const sf::Uint8* rgba = image.getPixelsPtr();
+		sf::Uint32 previous = 0;
+		uint8_t previous_index = 0;
+		for (size_t i = 0; i < indices.size(); i++) {
+			sf::Color c(rgba[4 * i], rgba[4 * i + 1], rgba[4 * i + 2], rgba[4 * i + 3]);
+			sf::Uint32 key = c.toInteger();
+			// runs of same color are frequent in pixel art
+			if (colors.empty() || key != previous) {
+				auto it = known.find(key);
+				if (it == known.end()) {
+					if (colors.size() == max_colors) {
+						colors.clear();
+						indices.clear();
+						return false;
+					}
+					it = known.emplace(key, static_cast<uint8_t>(colors.size())).first;
+					colors.push_back(c);
+				}
+				previous = key;
+				previous_index = it->second;
+			}
+			indices[i] = previous_index;
+		}
+		return true;
+	}
+}
@@ -1 +1,49 @@
-// interpolation.cpp
\ No newline at end of file
+// interpolation.cpp
+#include <utility>
+#include <PixelArt/interpolation.hpp>
+#include <PixelArt/interpolation_impl.hpp>
+
+namespace hpc
+{
+    interpolation::interpolation(std::vector<double> x, std::vector<double> y, size_t curves, method m)
+    {
+        if (m == method::spline)
+        {
+            p_impl = std::make_unique<spline_interpolation>(std::move(x), std::move(y), curves);
+        }
+        else
+        {
+            p_impl = std::make_unique<linear_interpolation>(std::move(x), std::move(y), curves);
+        }
+    }
+
+    interpolation::~interpolation() = default;
+
+    interpolation::interpolation(interpolation&&) = default;
+    interpolation& interpolation::operator=(interpolation&&) = default;
+
+    size_t interpolation::curves() const
+    {
+        return p_impl->curves();
+    }
+
+    size_t interpolation::knots() const
+    {
+        return p_impl->knots();
+    }
+
+    double interpolation::interpolate(size_t curve, double x) const
+    {
+        return p_impl->interpolate(curve, x);
+    }
+
+    void interpolation::interpolate(const double* x, double* out) const
+    {
+        p_impl->interpolate(x, out);
+    }
+
+    void interpolation::resample(const double* xs, size_t count, double* out) const
+    {
+        p_impl->resample(xs, count, out);
+    }
+}
@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <iterator>
 #include <iostream>
+#include <string>
+#include <utility>
 #include <PixelArt/interpolation_impl.hpp>
 
 namespace hpc
@@ -17,28 +19,59 @@ namespace hpc
         return (xhigh - x) * inv_den * ylow + (x - xlow) * inv_den * yhigh;
     }
 
+    // One row of the Thomas forward sweep of spline_derivative, for all the curves : rows l, m
+    // and h of the knots, modified upper diagonal and right hand side of the previous row in
+    // cl, dl, and of this one in cm, dm. Outputs are restrict so that the loop vectorizes.
+    void spline_forward_row(size_t curves,
+                            const double* xl, const double* xm, const double* xh,
+                            const double* yl, const double* ym, const double* yh,
+                            const double* cl, const double* dl,
+                            double* __restrict cm, double* __restrict dm)
+    {
+        for (size_t k = 0; k < curves; ++k)
+        {
+            double hl = xm[k] - xl[k];
+            double hh = xh[k] - xm[k];
+            double rhs = 6. * ((yh[k] - ym[k]) / hh - (ym[k] - yl[k]) / hl);
+            double inv_p = 1. / (2. * (hl + hh) - hl * cl[k]);
+            cm[k] = hh * inv_p;
+            dm[k] = (rhs - hl * dl[k]) * inv_p;
+        }
+    }
+
+    // Second derivatives of the natural cubic splines through the knots of a batch of
+    // curves, in the layout of interpolation_impl. The tridiagonal system of each curve
+    // is solved with the Thomas algorithm, every step running over all the curves.
     void spline_derivative(const std::vector<double>& x,
                            const std::vector<double>& y,
+                           size_t curves,
                            std::vector<double>& y2)
     {
-        size_t size = x.size();
-        std::vector<double> u(size);
-        y2.resize(size);
-        u.front() = 0.;
-        y2.front() = 0.;
-        for (size_t i = 1; i < size-2; ++i)
+        y2.assign(x.size(), 0.);
+        if (curves == 0 || x.size() / curves < 3)
+        {
+            return;
+        }
+        size_t size = x.size() / curves;
+        // forward sweep : modified upper diagonal in c, modified right hand side in y2.
+        // y2 is 0 at both ends, so the first row has no lower term.
+        std::vector<double> c(x.size(), 0.);
+        for (size_t i = 1; i < size - 1; ++i)
         {
-            double sig = (x[i] - x[i+1]) / (x[i+1] - x[i-1]);
-            double p = sig*y2[i-1] + 2.;
-            y2[i] = (sig - 1.) / p;
-            u[i] = (y[i+1] - y[i])/(x[i+1] - x[i]) - (y[i] - y[i-1])/(x[i] - x[i-1]);
-            u[i] = (6.*u[i]/x[i+1] - x[i-1]) - sig*u[i-1]/p;
+            size_t l = (i - 1) * curves, m = i * curves, h = (i + 1) * curves;
+            spline_forward_row(curves, &x[l], &x[m], &x[h], &y[l], &y[m], &y[h],
+                               &c[l], &y2[l], &c[m], &y2[m]);
         }
-        u.back() = 0.;
-        y2.back() = 0.;
-        for (size_t i = size - 2; i < size-2; --i)
+        // back substitution, the last row of y2 staying 0
+        for (size_t i = size - 2; i > 0; --i)
         {
-            y2[i] = y2[i]*y2[i+1] + u[i];
+            const double* cm = &c[i * curves];
+            const double* dh = &y2[(i + 1) * curves];
+            double* dm = &y2[i * curves];
+            for (size_t k = 0; k < curves; ++k)
+            {
+                dm[k] -= cm[k] * dh[k];
+            }
         }
     }
 
@@ -65,9 +98,127 @@ namespace hpc
      * interpolation_impl *
      **********************/
 
-    double interpolation_impl::interpolate(double x) const
+    interpolation_impl::interpolation_impl(std::vector<double> x, std::vector<double> y, size_t curves)
+        : m_x(std::move(x)), m_y(std::move(y)), m_curves(curves)
     {
-        return 0.;
     }
-}
 
+    size_t interpolation_impl::curves() const
+    {
+        return m_curves;
+    }
+
+    size_t interpolation_impl::knots() const
+    {
+        return m_curves ? m_x.size() / m_curves : 0;
+    }
+
+    size_t interpolation_impl::find_interval(size_t curve, double x) const
+    {
+        size_t low = 0;
+        size_t high = knots() - 1;
+        while (high - low > 1)
+        {
+            size_t mid = (low + high) / 2;
+            if (m_x[mid * m_curves + curve] <= x)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    double interpolation_impl::interpolate(size_t curve, double x) const
+    {
+        return value(curve, find_interval(curve, x), x);
+    }
+
+    void interpolation_impl::interpolate(const double* x, double* out) const
+    {
+        m_intervals.resize(m_curves);
+        for (size_t c = 0; c < m_curves; ++c)
+        {
+            m_intervals[c] = find_interval(c, x[c]);
+        }
+        values(m_intervals.data(), x, out);
+    }
+
+    void interpolation_impl::resample(const double* xs, size_t count, double* out) const
+    {
+        if (m_curves == 0)
+        {
+            return;
+        }
+        // intervals only move forward, all the curves are evaluated at once at each abscissa
+        std::vector<size_t>& k = m_intervals;
+        k.assign(m_curves, 0);
+        m_abscissae.resize(m_curves);
+        size_t last = knots() - 2;
+        for (size_t j = 0; j < count; ++j)
+        {
+            for (size_t c = 0; c < m_curves; ++c)
+            {
+                while (k[c] < last && m_x[(k[c] + 1) * m_curves + c] <= xs[j])
+                {
+                    ++k[c];
+                }
+            }
+            std::fill(m_abscissae.begin(), m_abscissae.end(), xs[j]);
+            values(k.data(), m_abscissae.data(), out + j * m_curves);
+        }
+    }
+
+    /************************
+     * linear_interpolation *
+     ************************/
+
+    double linear_interpolation::value(size_t curve, size_t k, double x) const
+    {
+        size_t low = k * m_curves + curve;
+        size_t high = low + m_curves;
+        return linear_interpolate(m_x[low], m_x[high], m_y[low], m_y[high], x);
+    }
+
+    void linear_interpolation::values(const size_t* k, const double* x, double* out) const
+    {
+        // same as value, without a virtual call per curve so that the loop body is inlined
+        for (size_t c = 0; c < m_curves; ++c)
+        {
+            size_t low = k[c] * m_curves + c;
+            size_t high = low + m_curves;
+            out[c] = linear_interpolate(m_x[low], m_x[high], m_y[low], m_y[high], x[c]);
+        }
+    }
+
+    /************************
+     * spline_interpolation *
+     ************************/
+
+    spline_interpolation::spline_interpolation(std::vector<double> x, std::vector<double> y, size_t curves)
+        : interpolation_impl(std::move(x), std::move(y), curves)
+    {
+        spline_derivative(m_x, m_y, m_curves, m_y2);
+    }
+
+    double spline_interpolation::value(size_t curve, size_t k, double x) const
+    {
+        size_t low = k * m_curves + curve;
+        size_t high = low + m_curves;
+        return spline_interpolate(m_x[low], m_x[high], m_y[low], m_y[high], m_y2[low], m_y2[high], x);
+    }
+
+    void spline_interpolation::values(const size_t* k, const double* x, double* out) const
+    {
+        // same as value, without a virtual call per curve so that the loop body is inlined
+        for (size_t c = 0; c < m_curves; ++c)
+        {
+            size_t low = k[c] * m_curves + c;
+            size_t high = low + m_curves;
+            out[c] = spline_interpolate(m_x[low], m_x[high], m_y[low], m_y[high], m_y2[low], m_y2[high], x[c]);
+        }
+    }
+}
@@ -1,9 +1,12 @@
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <utility>
 #include <vector>
 #include <PixelArt/voronoi_diagram.h>
+#include <PixelArt/smoothing.h>
 #include <PixelArt/image_op.h>
 #include <argparse.hpp>
 #include <filesystem>
@@ -12,18 +15,23 @@ enum Mode : int {
     DISPLAY_GRAPH,
     DISPLAY_VORONOI,
     DISPLAY_ACTIVE_EDGES,
+    DISPLAY_CURVES,
+    DISPLAY_SPLINES,
     NUM_MODES
 }mode;
 
 struct PixelArtArgs : public argparse::Args {
     std::string& src_path = kwarg("s", "source file/folder");
     float& default_scale = kwarg("z", "Default scale value of images").set_default(8.0);
+    float& tolerance = kwarg("t,tolerance", "Max distance in output pixels between splines and their polylines").set_default(0.25);
     std::vector<float>& yuv_similarity  = 
         kwarg("yuv", "max Y, U, V difference for initial graph construction (similarity determination)")
         .set_default(std::vector<float>({42.0, 7.0, 6.0}));
     std::vector<float>& yuv_edges =
         kwarg("dissimilarity", "YUV L^2 distances specifying active edges types (shading edge, contour edge)")
         .set_default(std::vector<float>({ 3.0/255.0, 100.0/255.0 }));
+    int& threads = kwarg("j,threads", "Number of threads for graph and diagram computation, 0 for one per core").set_default(0);
+    bool& palette = flag("p,palette", "Use palette lookup tables for color tests (images with at most 256 colors)");
     bool& verbose = flag("v,verbose", "A flag to toggle verbose");
 };
 
@@ -35,6 +43,10 @@ int main(int argc, char* argv[])
     PixelArtArgs args = argparse::parse<PixelArtArgs>(argc, argv);
     if (args.verbose)
         args.print();
+    if (!(args.default_scale > 0.0f) || !(args.tolerance > 0.0f)) {
+        std::cerr << "Scale and tolerance must be positive, exiting" << std::endl;
+        return -1;
+    }
 
 
     std::cout << "Starting exemple program" << std::endl;
@@ -94,6 +106,19 @@ int main(int argc, char* argv[])
     // Retrieve the window's default view
     sf::View view = window.getDefaultView();
 
+    // Graph and diagram of current file, with the parameters they were computed with
+    std::unique_ptr<pa::PixelGraph> similarity;
+    int similarity_file = -1;
+    pa::ColorYUV similarity_color;
+    pa::VoronoiDiagram diagram;
+    std::array<float, 2> diagram_edges = { 0.0f, 0.0f };
+    pa::CurveExtractor curves;
+    curves.setDiagram(diagram);
+    pa::CurveSmoother smoother;
+    smoother.setCurves(curves);
+    pa::QuadraticBSpline splines;
+    pa::Polylines polylines;
+
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
@@ -171,63 +196,54 @@ int main(int argc, char* argv[])
                 if (event.key.code == sf::Keyboard::C) {
                     disp_color = (disp_color + 1) % 2;
                 }
-                if (event.key.code == sf::Keyboard::Y) {
-                    if (event.key.code == sf::Keyboard::Up) {
-                        args.yuv_similarity[0] += 1.0;
-                    }
-                    else if (event.key.code == sf::Keyboard::Down) {
-                        args.yuv_similarity[0] -= 1.0;
-                    }
-                }
-
-                if (event.key.code == sf::Keyboard::U) {
-                    if (event.key.code == sf::Keyboard::Up) {
-                        args.yuv_similarity[1] += 1.0;
-                    }
-                    else if (event.key.code == sf::Keyboard::Down) {
-                        args.yuv_similarity[1] -= 1.0;
-                    }
-                }
-
-                if (event.key.code == sf::Keyboard::V) {
-                    if (event.key.code == sf::Keyboard::Up) {
-                        args.yuv_similarity[2] += 1.0;
-                    }
-                    else if (event.key.code == sf::Keyboard::Down) {
-                        args.yuv_similarity[2] -= 1.0;
-                    }
-                }
-
-                if (event.key.code == sf::Keyboard::S) {
-                    if (event.key.code == sf::Keyboard::Up) {
-                        args.yuv_edges[0] += 1.0;
-                    }
-                    else if (event.key.code == sf::Keyboard::Down) {
-                        args.yuv_edges[0] -= 1.0;
-                    }
-                }
-
-                if (event.key.code == sf::Keyboard::Q) {
-                    if (event.key.code == sf::Keyboard::Up) {
-                        args.yuv_edges[1] += 1.0;
-                    }
-                    else if (event.key.code == sf::Keyboard::Down) {
-                        args.yuv_edges[1] -= 1.0;
-                    }
+                // Hold Y, U, V, S or Q and press Up / Down to tune parameters
+                if (event.key.code == sf::Keyboard::Up || event.key.code == sf::Keyboard::Down) {
+                    float step = event.key.code == sf::Keyboard::Up ? 1.0f : -1.0f;
+                    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Y))
+                        args.yuv_similarity[0] += step;
+                    if (sf::Keyboard::isKeyPressed(sf::Keyboard::U))
+                        args.yuv_similarity[1] += step;
+                    if (sf::Keyboard::isKeyPressed(sf::Keyboard::V))
+                        args.yuv_similarity[2] += step;
+                    if (sf::Keyboard::isKeyPressed(sf::Keyboard::S))
+                        args.yuv_edges[0] += step;
+                    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Q))
+                        args.yuv_edges[1] += step;
                 }
             }
         }
 
-        // Calculations
-        auto param_pixel = pa::PixelGraphParam(inputImage, pa::ColorYUV(args.yuv_similarity[0], args.yuv_similarity[1], args.yuv_similarity[2]));
-        pa::PixelGraph similarity(param_pixel);
-        //Planarize the graph
-        similarity.compute();
+        // Calculations, only when image or parameters changed
+        pa::ColorYUV color(args.yuv_similarity[0], args.yuv_similarity[1], args.yuv_similarity[2]);
+        bool graph_changed = false;
+        if (!similarity || similarity_file != file_number) {
+            auto param_pixel = pa::PixelGraphParam(inputImage, color, args.palette);
+            similarity = std::make_unique<pa::PixelGraph>(param_pixel);
+            //Planarize the graph
+            similarity->compute(static_cast<unsigned>(std::max(0, args.threads)));
+            similarity_file = file_number;
+            similarity_color = color;
+            dim = inputImage.getSize();
+            graph_changed = true;
+        }
+        else if (color.Y != similarity_color.Y || color.U != similarity_color.U || color.V != similarity_color.V) {
+            // only crossings around changed edges are resolved again
+            similarity->update(color);
+            similarity_color = color;
+            graph_changed = true;
+        }
 
-        auto param_voronoi = pa::EdgeDissimilarityParam(args.yuv_edges[0], args.yuv_edges[1]);
-        pa::VoronoiDiagram diagram(param_voronoi);
-        diagram.setGraph(similarity);
-        diagram.compute();
+        if (graph_changed || args.yuv_edges[0] != diagram_edges[0] || args.yuv_edges[1] != diagram_edges[1]) {
+            diagram.setParam(pa::EdgeDissimilarityParam(args.yuv_edges[0], args.yuv_edges[1]));
+            diagram.setGraph(*similarity);
+            diagram.compute(static_cast<unsigned>(std::max(0, args.threads)));
+            diagram_edges = { args.yuv_edges[0], args.yuv_edges[1] };
+            curves.compute();
+            smoother.compute(static_cast<unsigned>(std::max(0, args.threads)));
+            splines.clear();
+            smoother.appendSplines(splines);
+            splines.flatten(args.default_scale, args.tolerance, polylines);
+        }
 
         // Draw our simple scene
         window.clear(sf::Color(150, 150, 150));
@@ -245,11 +261,11 @@ int main(int argc, char* argv[])
         switch (mode) {
         case Mode::DISPLAY_GRAPH:
         {
-            auto& graph_edges = similarity.getGraph();
+            auto& graph_edges = similarity->getGraph();
             for (int i = 0; i < dim.x; i++) {
                 for (int j = 0; j < dim.y; j++) {
                     for (int k = 0; k < pa::NUM_DIR; k++) {
-                        if (graph_edges[i][j][k]) {
+                        if (graph_edges(i, j) & (1 << k)) {
                             auto dir = pa::VecDir[k];
                             line[0].position = scale * sf::Vector2f(i + 0.5f, j + 0.5f);
                             line[1].position = scale * sf::Vector2f(i + 0.5f + dir.x, j + 0.5f + dir.y);
@@ -262,27 +278,22 @@ int main(int argc, char* argv[])
         }
         case Mode::DISPLAY_VORONOI:
         {
-            const pa::diagram& d = diagram.getDiagram();
-            for (auto& vec : d) {
-                for (auto& p : vec.second) {
-                    line[0].position = scale * vec.first;
-                    line[1].position = scale * p;
-                    window.draw(line, 2, sf::Lines);
-                }
+            const pa::VoronoiMesh& d = diagram.getDiagram();
+            for (uint32_t e = 0; e < d.halfEdgeCount(); e++) {
+                line[0].position = scale * pa::to_point(d.vertices[d.origin[e]]);
+                line[1].position = scale * pa::to_point(d.vertices[d.target(e)]);
+                window.draw(line, 2, sf::Lines);
             }
             break;
         }
         case Mode::DISPLAY_ACTIVE_EDGES:
         {
             const pa::edge_list& active_edges = diagram.getActiveEdges();
-            for (auto& edge_color : active_edges) {
-                auto& edge = edge_color.first;
-                /*if (&(*active_edges.find(pa::Edge(edge.p2, edge.p1))) != &edge_color) {
-                    std::cout << "Problem on edges hash table" <<std::endl;
-                }*/
-                auto& colors = edge_color.second.colors;
-                line[0].position = scale * edge.p1;
-                line[1].position = scale * edge.p2;
+            for (auto& active : active_edges) {
+                pa::Edge edge = active.edge();
+                auto& colors = active.colors;
+                line[0].position = scale * pa::to_point(edge.p1);
+                line[1].position = scale * pa::to_point(edge.p2);
                 line[0].color = colors[disp_color];
                 line[1].color = colors[disp_color];
 
@@ -290,6 +301,33 @@ int main(int argc, char* argv[])
             }
             break;
         }
+        case Mode::DISPLAY_CURVES:
+        {
+            // one color per curve
+            const pa::VoronoiMesh& d = diagram.getDiagram();
+            const pa::CurveList& list = curves.getCurves();
+            std::vector<sf::Vertex> strip;
+            for (size_t c = 0; c < list.size(); c++) {
+                sf::Color color(static_cast<sf::Uint8>(c * 97 + 64), static_cast<sf::Uint8>(c * 61 + 128), static_cast<sf::Uint8>(c * 37));
+                strip.clear();
+                for (uint32_t i = list.offsets[c]; i < list.offsets[c + 1]; i++)
+                    strip.emplace_back(scale * pa::to_point(d.vertices[list.vertices[i]]), color);
+                window.draw(strip.data(), strip.size(), sf::LineStrip);
+            }
+            break;
+        }
+        case Mode::DISPLAY_SPLINES:
+        {
+            // flattened for the default scale
+            std::vector<sf::Vertex> strip;
+            for (size_t c = 0; c < polylines.size(); c++) {
+                strip.clear();
+                for (uint32_t i = polylines.offsets[c]; i < polylines.offsets[c + 1]; i++)
+                    strip.emplace_back(polylines.points[i], sf::Color::Red);
+                window.draw(strip.data(), strip.size(), sf::LineStrip);
+            }
+            break;
+        }
         }
 
 
@@ -1,6 +1,8 @@
 #include <PixelArt/pixel_graph.h>
+#include <PixelArt/thread_pool.h>
 #include <utility>
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 #include <stack>
 
@@ -12,41 +14,71 @@ namespace pa {
 	PixelGraph::PixelGraph(const PixelGraphParam& p) : dim(p.image.getSize()), m_test_similarity(p)
 	{
 		init_graph();
+		extract_cell_types();
 	}
 
 	PixelGraph::PixelGraph(PixelGraphParam&& p) : dim(p.image.getSize()), m_test_similarity(p)
 	{
 		init_graph();
+		extract_cell_types();
 	}
 
 
-	PixelGraph::PixelGraph(const PixelGraph& g) : m_test_similarity(g.m_test_similarity.getParam())
+	PixelGraph::PixelGraph(const PixelGraph& g) : dim(g.dim), m_test_similarity(g.m_test_similarity.getParam())
 	{
 		m_graph = g.getGraph();
+		m_initial_masks = g.m_initial_masks;
+		m_computed = g.m_computed;
+		m_cell_types = g.m_cell_types;
 	}
 
 
+	// Number of edges in each neighbour mask
+	static constexpr std::array<uint8_t, 256> mask_valence = [] {
+		std::array<uint8_t, 256> count{};
+		for (size_t mask = 1; mask < 256; mask++)
+			count[mask] = static_cast<uint8_t>((mask & 1) + count[mask >> 1]);
+		return count;
+	}();
+
+	// Directions of the neighbours not yet seen when going through the image column by column.
+	// Their opposite is the direction back to the current pixel.
+	static const std::array<Direction, 4> forward_dirs{ RIGHT, BOTTOM_RIGHT, BOTTOM, TOP_RIGHT };
+
 	void PixelGraph::init_graph() {
 		//Preallocating structures, initialize to zero
-		const weight_per_dir temp_wpd = {}; // initialize to zero
-		const std::vector< weight_per_dir > temp_vec(dim.y, temp_wpd);
-		m_graph.resize(dim.x, temp_vec);
-
-		// Adding edge for pixels with similar colors
-		for (int i = 0; i < dim.x; i++) {
-			for (int j = 0; j < dim.y; j++) {
-				for (int k = 0; k < NUM_DIR; k++) {
-					IntPoint current_pixel(i, j);
-					IntPoint adj_pixel = current_pixel + VecDir[k];
-					// if both pixel are sufficiently similar, weight = 1
-					if (isValid(adj_pixel, dim))
-						m_graph[i][j][k] = m_test_similarity(current_pixel, adj_pixel);
+		m_graph.reset(dim);
+
+		// Each pair of neighbours is tested once, from its first pixel, and the edge
+		// added in both directions if both pixels are sufficiently similar
+		auto link = [this](const IntPoint& p, Direction k) {
+			IntPoint adj_pixel = p + VecDir[k];
+			if (m_test_similarity(p, adj_pixel)) {
+				m_graph(p.x, p.y) |= static_cast<neighbour_mask>(1u << k);
+				m_graph(adj_pixel.x, adj_pixel.y) |= static_cast<neighbour_mask>(1u << opposite(k));
+			}
+		};
+
+		const int width = static_cast<int>(dim.x);
+		const int height = static_cast<int>(dim.y);
+		for (int i = 0; i < width; i++) {
+			for (int j = 0; j < height; j++) {
+				IntPoint current_pixel(i, j);
+				// forward neighbours of interior pixels are all in the image
+				if (i < width - 1 && j > 0 && j < height - 1) {
+					for (Direction k : forward_dirs)
+						link(current_pixel, k);
+				}
+				else {
+					for (Direction k : forward_dirs)
+						if (isValid(current_pixel + VecDir[k], dim))
+							link(current_pixel, k);
 				}
 			}
 		}
 	}
 
-	square&& PixelGraph::get_square(const IntPoint& top_left) {
+	square PixelGraph::get_square(const IntPoint& top_left) const {
 		return square{
 		top_left,
 		IntPoint(top_left + VecDir[Direction::BOTTOM_RIGHT]),
@@ -64,14 +96,22 @@ namespace pa {
 		return false;
 	}
 
-	bool PixelGraph::check_additional_connection_and_remove_trivial_cross(const IntPoint& top_left)
+	int PixelGraph::additional_connections(const IntPoint& top_left) const
 	{
-		DECLARE_SQUARE_VARS(top_left)
+		IntPoint bottom_left(top_left + VecDir[BOTTOM]);
+		IntPoint bottom_right(top_left + VecDir[BOTTOM_RIGHT]);
 
-		int test = edge(top_left, Direction::BOTTOM)
+		return edge(top_left, Direction::BOTTOM)
 			| edge(top_left, Direction::RIGHT) << 1
 			| edge(bottom_left, Direction::RIGHT) << 2
 			| edge(bottom_right, Direction::TOP) << 3;
+	}
+
+	bool PixelGraph::check_additional_connection_and_remove_trivial_cross(const IntPoint& top_left)
+	{
+		DECLARE_SQUARE_VARS(top_left)
+
+		int test = additional_connections(top_left);
 
 		if (test == 15) {
 			//All colors are same in the square, remove diagonal edges
@@ -85,36 +125,28 @@ namespace pa {
 	}
 
 
-	int PixelGraph::valence(const IntPoint& p)
+	int PixelGraph::valence(const IntPoint& p) const
 	{
-		//Count the edges around the pixel
-		int cnt = 0;
-		for (int i = 0; i < NUM_DIR; i++)
-			if (isValid(p + VecDir[i], dim) && edge(p, static_cast<Direction>(i)))
-				cnt++;
-		return cnt;
+		//Count the edges around the pixel. They only go to pixels inside the image.
+		return mask_valence[m_graph(p.x, p.y)];
 	}
 
 	//Checks for Isolated pixels
-	void PixelGraph::islands_heuristic(const IntPoint& top_left)
+	template<class G>
+	void PixelGraph::islands_heuristic(const G& g, const IntPoint& top_left, diagonal_weights& weights) const
 	{
 		DECLARE_SQUARE_VARS(top_left)
 
-		int left_diag = 5 * (valence(top_left) == 1 + valence(bottom_right) == 1);
-		m_graph[top_left.x][top_left.y][Direction::BOTTOM_RIGHT] += left_diag;
-		m_graph[bottom_right.x][bottom_right.y][Direction::TOP_LEFT] += left_diag;
-
-		int right_diag = 5 * (valence(top_right) == 1 + valence(bottom_left) == 1);
-		m_graph[top_right.x][top_right.y][Direction::BOTTOM_LEFT] += right_diag;
-		m_graph[bottom_left.x][bottom_left.y][Direction::TOP_RIGHT] += right_diag;
-
+		weights[0] += 5 * (g.valence(top_left) == 1 + g.valence(bottom_right) == 1);
+		weights[1] += 5 * (g.valence(top_right) == 1 + g.valence(bottom_left) == 1);
 	}
 
 	bool PixelGraph::are_dir_opposite(Direction d1, Direction d2) const {
 		return VecDir[d1] + VecDir[d2] == sf::Vector2i(0, 0);
 	}
 
-	int PixelGraph::count_curve_edges(IntPoint a, const Direction d) {
+	template<class G>
+	int PixelGraph::count_curve_edges(const G& g, IntPoint a, const Direction d) const {
 		int curve_length = 1;
 		IntPoint b(a + VecDir[d]);
 
@@ -128,27 +160,27 @@ namespace pa {
 		}
 
 		// first, parcouring from 'a'
-		while (valence(a) == 2 && a != b) {
+		while (g.valence(a) == 2 && a != b) {
 			curve_length++;
 			// finding next direction. Cannot be opposite to old direction d !
 			int new_dir = 0;
-			std::find_if(m_graph[a.x][a.y].begin(), m_graph[a.x][a.y].end(),
-				[this, &actual_dir, &new_dir](int& dir_weight) mutable
-				{return !are_dir_opposite(actual_dir, static_cast<Direction>(new_dir++)) && dir_weight > 0; });
-			actual_dir = static_cast<Direction>(--new_dir);
+			while (new_dir < NUM_DIR - 1
+				&& (are_dir_opposite(actual_dir, static_cast<Direction>(new_dir)) || !g.edge(a, static_cast<Direction>(new_dir))))
+				new_dir++;
+			actual_dir = static_cast<Direction>(new_dir);
 			a += VecDir[actual_dir];
 		}
 
 		actual_dir = d;
 		// Now from 'b'
-		while (valence(b) == 2 && b != a) {
+		while (g.valence(b) == 2 && b != a) {
 			curve_length++;
 			// finding next direction. Cannot be opposite to old direction d !
 			int new_dir = 0;
-			std::find_if(m_graph[b.x][b.y].begin(), m_graph[b.x][b.y].end(),
-				[this, &actual_dir, &new_dir](int& dir_weight) mutable
-				{return !are_dir_opposite(actual_dir, static_cast<Direction>(new_dir++)) && dir_weight > 0; });
-			actual_dir = static_cast<Direction>(--new_dir);
+			while (new_dir < NUM_DIR - 1
+				&& (are_dir_opposite(actual_dir, static_cast<Direction>(new_dir)) || !g.edge(b, static_cast<Direction>(new_dir))))
+				new_dir++;
+			actual_dir = static_cast<Direction>(new_dir);
 			b += VecDir[actual_dir];
 		}
 
@@ -156,95 +188,351 @@ namespace pa {
 
 	}
 
-	//Curves Heuristic
-	void PixelGraph::curves_heuristic(const IntPoint& top_left)
+	// Plain walk on the graph itself, compared with CurveChains by the tests
+	template int PixelGraph::count_curve_edges(const PixelGraph& g, IntPoint a, const Direction d) const;
+
+	PixelGraph::CurveChains::CurveChains(const PixelGraph& graph) :
+		m_graph(graph),
+		m_label(graph.m_graph.masks.size(), -1)
+	{}
+
+	size_t PixelGraph::CurveChains::label_chain(const IntPoint& p) const
 	{
-		DECLARE_SQUARE_VARS(top_left)
+		size_t chain = m_length.size();
+		int id = static_cast<int>(chain);
+		m_label[m_graph.m_graph.index(p.x, p.y)] = id;
+		int internal = 1;
+		bool cycle = false;
+		bool changed = tracking() && dirty(p);
+
+		// walk away from p on both its edges, labelling valence-2 pixels
+		for (int k = 0; k < NUM_DIR && !cycle; k++) {
+			if (!m_graph.edge(p, static_cast<Direction>(k)))
+				continue;
+			Direction came = static_cast<Direction>(k);
+			IntPoint cur(p + VecDir[came]);
+			while (cur != p && m_graph.valence(cur) == 2) {
+				m_label[m_graph.m_graph.index(cur.x, cur.y)] = id;
+				changed = changed || (tracking() && dirty(cur));
+				internal++;
+				// the other edge of cur
+				int next = 0;
+				while (next == opposite(came) || !m_graph.edge(cur, static_cast<Direction>(next)))
+					next++;
+				came = static_cast<Direction>(next);
+				cur += VecDir[came];
+			}
+			cycle = cur == p;
+			// chain end is read too
+			changed = changed || (tracking() && dirty(cur));
+		}
 
-		// top_left to bottom_right
-		int left_curve_length = count_curve_edges(top_left, BOTTOM_RIGHT);
-		m_graph[top_left.x][top_left.y][Direction::BOTTOM_RIGHT] += left_curve_length;
-		m_graph[bottom_right.x][bottom_right.y][Direction::TOP_LEFT] += left_curve_length;
+		// a cycle has as many edges as pixels, a curve one more
+		m_length.push_back(cycle ? internal : internal + 1);
+		m_chain_dirty.push_back(changed);
+		return chain;
+	}
 
-		// top_right to bottom_left
-		int right_curve_length = count_curve_edges(top_right, BOTTOM_LEFT);
-		m_graph[top_right.x][top_right.y][Direction::BOTTOM_LEFT] += right_curve_length;
-		m_graph[bottom_left.x][bottom_left.y][Direction::TOP_RIGHT] += right_curve_length;
+	size_t PixelGraph::CurveChains::label(const IntPoint& p) const
+	{
+		int id = m_label[m_graph.m_graph.index(p.x, p.y)];
+		if (id < 0 || m_length[static_cast<size_t>(id)] < 0)
+			return label_chain(p);
+		return static_cast<size_t>(id);
+	}
+
+	int PixelGraph::CurveChains::curve_edges(const IntPoint& a, Direction d) const
+	{
+		// edge a-b is inside the chain of a or b if one of them has valence 2, else on its own
+		IntPoint b(a + VecDir[d]);
+		if (m_graph.valence(a) == 2)
+			return m_length[label(a)];
+		if (m_graph.valence(b) == 2)
+			return m_length[label(b)];
+		return 1;
+	}
+
+	void PixelGraph::CurveChains::edge_removed(const IntPoint& p)
+	{
+		int v = m_graph.valence(p);
+		if (v > 2)
+			return;
+
+		int& id = m_label[m_graph.m_graph.index(p.x, p.y)];
+		// p was inside a chain, which is now cut
+		if (v == 1 && id >= 0)
+			m_length[static_cast<size_t>(id)] = -1;
+		// p joins the chains of its two edges
+		if (v == 2) {
+			id = -1;
+			for (size_t k = 0; k < NUM_DIR; k++) {
+				if (!m_graph.edge(p.x, p.y, static_cast<Direction>(k)))
+					continue;
+				IntPoint n(p + VecDir[k]);
+				int n_id = m_label[m_graph.m_graph.index(n.x, n.y)];
+				if (n_id >= 0)
+					m_length[static_cast<size_t>(n_id)] = -1;
+			}
+		}
+	}
 
+	void PixelGraph::CurveChains::edge_removed(const IntPoint& a, const IntPoint& b)
+	{
+		edge_removed(a);
+		edge_removed(b);
 	}
 
+	void PixelGraph::CurveChains::track_changes(std::vector<uint8_t> dirty)
+	{
+		m_dirty = std::move(dirty);
+	}
 
-	//Checks if (x,y) are inclusively inside the given cell
-	bool insideBounds(const IntPoint& p, int row_st, int row_end, int col_st, int col_end)
+	void PixelGraph::CurveChains::set_dirty(const IntPoint& p)
 	{
-		return (p.x >= row_st && p.x <= row_end && p.y >= col_st && p.y <= col_end);
+		m_dirty[m_graph.m_graph.index(p.x, p.y)] = 1;
+		// chains through p, or ending on it
+		for (size_t k = 0; k <= NUM_DIR; k++) {
+			IntPoint n(p + VecDir[k]);
+			int id = m_label[m_graph.m_graph.index(n.x, n.y)];
+			if (id >= 0)
+				m_chain_dirty[static_cast<size_t>(id)] = 1;
+		}
 	}
 
-	// DFS on 8*8 limited grid. num_label is number of the labels to put on start point
-	// connex component. top_left point so we can know where to center the grid
-	// grid labels must be 0 to consider that is not yet in any component
-	void PixelGraph::DFS_grid_limited(const IntPoint& top_left, const IntPoint& start, int grid[8][8], int num_label) {
-		std::vector<IntPoint> stack;
-		stack.reserve(48);
-		stack.push_back(start);
-		while (!stack.empty())
+	bool PixelGraph::CurveChains::window_dirty(const IntPoint& top_left) const
+	{
+		for (int i = -3; i <= 4; i++) {
+			// window column is contiguous
+			const uint8_t* column = &m_dirty[m_graph.m_graph.index(top_left.x + i, top_left.y - 3)];
+			for (int j = 0; j < 8; j++)
+				if (column[j])
+					return true;
+		}
+		return false;
+	}
+
+	bool PixelGraph::CurveChains::curve_dirty(const IntPoint& a, Direction d) const
+	{
+		// same chain as curve_edges, ends included
+		IntPoint b(a + VecDir[d]);
+		if (m_graph.valence(a) == 2)
+			return m_chain_dirty[label(a)] != 0;
+		if (m_graph.valence(b) == 2)
+			return m_chain_dirty[label(b)] != 0;
+		return dirty(a) || dirty(b);
+	}
+
+	//Curves Heuristic
+	template<class G>
+	void PixelGraph::curves_heuristic(const G& g, const IntPoint& top_left, diagonal_weights& weights) const
+	{
+		IntPoint top_right(top_left + VecDir[Direction::RIGHT]);
+
+		// top_left to bottom_right
+		weights[0] += count_curve_edges(g, top_left, BOTTOM_RIGHT);
+		// top_right to bottom_left
+		weights[1] += count_curve_edges(g, top_right, BOTTOM_LEFT);
+	}
+
+
+	// Sparse pixels heuristic works on the 8x8 window around the square, as bitboards :
+	// bit 8 * gx + gy is pixel (top_left.x - 3 + gx, top_left.y - 3 + gy).
+	namespace {
+		using window_board = uint64_t;
+
+		const int window_top_left = 8 * 3 + 3;
+		const int window_top_right = 8 * 4 + 3;
+
+		// Transposes the 8x8 bit matrix stored in x, byte i being row i
+		window_board transpose8(window_board x)
 		{
-			IntPoint point = stack.back();
-			stack.pop_back();
-			for (int i = 0; i < NUM_DIR; i++)
-			{
-				//See in all directions, scan for points that are in the not yet visited, 
-				// in the 8x8 box, and have an edge from the current point.
-				if (!m_graph[point.x][point.y][i])
-					continue;
+			window_board t;
+			t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+			x = x ^ t ^ (t << 7);
+			t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+			x = x ^ t ^ (t << 14);
+			t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+			x = x ^ t ^ (t << 28);
+			return x;
+		}
 
-				IntPoint nextPoint(point + VecDir[i]);
-				if (!insideBounds(nextPoint, top_left.x - 3, top_left.x + 4, top_left.y - 3, top_left.y + 4))
-					continue;
+		int board_count(window_board x)
+		{
+			x = x - ((x >> 1) & 0x5555555555555555ull);
+			x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+			x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+			return static_cast<int>((x * 0x0101010101010101ull) >> 56);
+		}
 
-				IntPoint gridPoint(nextPoint - top_left + IntPoint(3, 3));
-				if (grid[gridPoint.x][gridPoint.y] != 0) continue;
-				grid[gridPoint.x][gridPoint.y] = num_label;
-				stack.push_back(nextPoint);
+		// Pixels of the window reachable from start without leaving the window.
+		// edges[k] has the pixels with an edge in kth direction.
+		window_board flood_window(const std::array<window_board, NUM_DIR>& edges, window_board start)
+		{
+			window_board visited = start, frontier = start;
+			while (frontier) {
+				window_board next = 0;
+				for (size_t k = 0; k < NUM_DIR; k++) {
+					window_board from = frontier & edges[k];
+					// no wrapping from a column end to the next one
+					if (VecDir[k].y > 0)
+						from &= ~0x8080808080808080ull;
+					else if (VecDir[k].y < 0)
+						from &= ~0x0101010101010101ull;
+					// edges leaving the window on x are shifted out
+					int shift = 8 * VecDir[k].x + VecDir[k].y;
+					next |= shift > 0 ? from << static_cast<unsigned>(shift) : from >> static_cast<unsigned>(-shift);
+				}
+				frontier = next & ~visited;
+				visited |= frontier;
 			}
+			return visited;
 		}
 	}
 
-	void PixelGraph::sparse_pixels_heuristic(const IntPoint& top_left)
+	template<class G>
+	void PixelGraph::sparse_pixels_heuristic(const G& g, const IntPoint& top_left, diagonal_weights& weights) const
 	{
-		DECLARE_SQUARE_VARS(top_left)
+		// Edge masks of the window, one board per direction.
+		// A window column is 8 masks, bit k of row gy is moved to bit gy of row k.
+		std::array<window_board, NUM_DIR> edges{};
+		for (int gx = 0; gx < 8; gx++) {
+			window_board column = 0;
+			for (int gy = 0; gy < 8; gy++)
+				column |= static_cast<window_board>(g.mask(top_left + IntPoint(gx - 3, gy - 3))) << (8 * gy);
+			column = transpose8(column);
+			for (size_t k = 0; k < NUM_DIR; k++)
+				edges[k] |= ((column >> (8 * k)) & 0xFF) << (8 * gx);
+		}
 
-		int grid[8][8] = { 0 };
-		grid[3][3] = 1;
-		DFS_grid_limited(top_left, top_left, grid, 1);
-		grid[4][3] = 2;
-		DFS_grid_limited(top_left, top_right, grid, 2);
+		// Component of top_left, then of top_right among pixels not yet labelled.
+		// If both are connected, top_right alone is relabelled for the second one.
+		window_board componentA = flood_window(edges, 1ull << window_top_left);
+		int sizeA = board_count(componentA);
+		int sizeB = 1;
+		if (componentA & (1ull << window_top_right))
+			sizeA--;
+		else
+			sizeB = board_count(flood_window(edges, 1ull << window_top_right));
+
+		weights[0] += sizeA;
+		weights[1] += sizeB;
+	}
 
+	// On the graph masks, compared with a plain flood fill by the tests
+	template void PixelGraph::sparse_pixels_heuristic(const CurveChains& g, const IntPoint& top_left, diagonal_weights& weights) const;
 
-		//Find the size of the components
-		int componentA = 0;
-		int componentB = 0;
 
-		for (int i = 0; i < 8; i++)
-			for (int j = 0; j < 8; j++)
-			{
-				if (grid[i][j] == 1) componentA++;
-				else if (grid[i][j] == 2) componentB++;
-			}
 
-		// end
+	template<class G>
+	diagonal_weights PixelGraph::heuristic_weights(const G& g, const IntPoint& top_left) const
+	{
+		diagonal_weights weights = { 1, 1 };
+		islands_heuristic(g, top_left, weights);
+		curves_heuristic(g, top_left, weights);
+		sparse_pixels_heuristic(g, top_left, weights);
+		return weights;
+	}
 
-		m_graph[top_left.x][top_left.y][Direction::BOTTOM_RIGHT] += componentA;
-		m_graph[bottom_right.x][bottom_right.y][Direction::TOP_LEFT] += componentA;
 
-		m_graph[top_right.x][top_right.y][Direction::BOTTOM_LEFT] += componentB;
-		m_graph[bottom_left.x][bottom_left.y][Direction::TOP_RIGHT] += componentB;
+	void PixelGraph::compute(unsigned threads)
+	{
+		// taken by the first update only
+		std::vector<neighbour_mask>().swap(m_initial_masks);
+		m_computed = true;
+
+		// not worth it on small images
+		if (threads != 1 && static_cast<size_t>(dim.x) * dim.y >= 64 * 64)
+			compute_parallel(threads);
+		else
+			resolve_crossings(nullptr);
+		extract_cell_types();
 	}
 
 
+	void PixelGraph::update(const ColorYUV& color)
+	{
+		if (!m_computed) {
+			m_test_similarity.getOp().setColor(color);
+			init_graph();
+			extract_cell_types();
+			return;
+		}
+		if (m_initial_masks.empty()) {
+			// masks before crossing resolution, tested again with the previous thresholds
+			pixel_graph_edges resolved = std::move(m_graph);
+			init_graph();
+			m_initial_masks = std::move(m_graph.masks);
+			m_graph = std::move(resolved);
+		}
+		m_test_similarity.getOp().setColor(color);
 
-	void PixelGraph::compute()
+		// the buffer of the resolved masks is reused for the next snapshot
+		pixel_graph_edges previous = std::move(m_graph);
+		previous.masks.swap(m_initial_masks);
+		init_graph();
+		m_initial_masks.assign(m_graph.masks.begin(), m_graph.masks.end());
+		resolve_crossings(&previous);
+		extract_cell_types();
+	}
+
+	// Bit i of a cell type is set if there is a diagonal from node_parcours[i] towards
+	// edges_parcours[i % 2] (see voronoi_diagram.h). It is a diagonal bit of the mask of the
+	// pixel or of its left, top or bottom neighbour, read without bounds checks thanks to the border.
+	void PixelGraph::extract_cell_types()
+	{
+		m_cell_types.resize(static_cast<size_t>(dim.x) * dim.y);
+		const int height = static_cast<int>(dim.y);
+		for (int x = 0; x < static_cast<int>(dim.x); x++) {
+			const neighbour_mask* masks = &m_graph.masks[m_graph.index(x, 0)];
+			const neighbour_mask* left = masks - m_graph.stride;
+			uint8_t* types = &m_cell_types[static_cast<size_t>(x) * dim.y];
+			for (int y = 0; y < height; y++) {
+				types[y] = static_cast<uint8_t>(((masks[y] >> TOP_LEFT) & 1)
+					| ((left[y] >> TOP_RIGHT) & 1) << 1
+					| ((masks[y - 1] >> BOTTOM_RIGHT) & 1) << 2
+					| ((masks[y] >> TOP_RIGHT) & 1) << 3
+					| ((masks[y] >> BOTTOM_RIGHT) & 1) << 4
+					| ((masks[y + 1] >> TOP_RIGHT) & 1) << 5
+					| ((left[y] >> BOTTOM_RIGHT) & 1) << 6
+					| ((masks[y] >> BOTTOM_LEFT) & 1) << 7);
+			}
+		}
+	}
+
+
+	// Diagonals left in square top_left by crossing resolution, from the initial masks
+	// and weights of heuristic squares
+	static std::array<bool, 2> resolved_diagonals(const pixel_graph_edges& initial, const IntPoint& top_left)
+	{
+		IntPoint bottom_left(top_left + VecDir[BOTTOM]);
+		IntPoint bottom_right(top_left + VecDir[BOTTOM_RIGHT]);
+		bool diagonal0 = (initial(top_left.x, top_left.y) >> BOTTOM_RIGHT) & 1;
+		bool diagonal1 = (initial(bottom_left.x, bottom_left.y) >> TOP_RIGHT) & 1;
+		if (!diagonal0 || !diagonal1)
+			return { diagonal0, diagonal1 };
+
+		int test = ((initial(top_left.x, top_left.y) >> BOTTOM) & 1)
+			| ((initial(top_left.x, top_left.y) >> RIGHT) & 1) << 1
+			| ((initial(bottom_left.x, bottom_left.y) >> RIGHT) & 1) << 2
+			| ((initial(bottom_right.x, bottom_right.y) >> TOP) & 1) << 3;
+		if (test == 15)
+			return { false, false };
+		if (test > 0)
+			return { true, true };
+		const diagonal_weights& weights = initial.cross_weights.at(initial.index(top_left.x, top_left.y));
+		return { weights[0] > weights[1], weights[0] <= weights[1] };
+	}
+
+	void PixelGraph::resolve_crossings(const pixel_graph_edges* previous)
 	{
+		CurveChains chains(*this);
+		if (previous) {
+			std::vector<uint8_t> dirty(m_graph.masks.size());
+			for (size_t i = 0; i < dirty.size(); i++)
+				dirty[i] = m_graph.masks[i] != previous->masks[i];
+			chains.track_changes(std::move(dirty));
+		}
+
 		//For Internal Pixels, process via heuristic if edges are crossing
 		//A Pixel is the topLeft of a 2x2 box
 		// 
@@ -254,50 +542,301 @@ namespace pa {
 			{
 				IntPoint top_left(i, j);
 				DECLARE_SQUARE_VARS(top_left)
+				bool recomputed = false;
 
 				if (cross(top_left)) {
-					if (check_additional_connection_and_remove_trivial_cross(top_left))
-						continue;
-
-					//Run heuristics and update weights
-					islands_heuristic(top_left);
-					curves_heuristic(top_left);
-					sparse_pixels_heuristic(top_left);
-
-					//Remove lighter edge, or both if equality (no else if)
-					if (m_graph[top_left.x][top_left.y][BOTTOM_RIGHT] <= m_graph[top_right.x][top_right.y][BOTTOM_LEFT])
-					{
-						delete_edge(top_left, BOTTOM_RIGHT);
-						delete_edge(bottom_right, TOP_LEFT);
+					if (check_additional_connection_and_remove_trivial_cross(top_left)) {
+						// diagonals are gone if the cross was trivial
+						if (!edge(top_left, BOTTOM_RIGHT)) {
+							chains.edge_removed(top_left, bottom_right);
+							chains.edge_removed(top_right, bottom_left);
+						}
 					}
-					if (m_graph[top_left.x][top_left.y][BOTTOM_RIGHT] >= m_graph[top_right.x][top_right.y][BOTTOM_LEFT])
-					{
-						delete_edge(top_right, BOTTOM_LEFT);
-						delete_edge(bottom_left, TOP_RIGHT);
+					else {
+						//Run heuristics and update weights, stored in the side table.
+						//Previous weights are still valid if no pixel read by heuristics has changed.
+						diagonal_weights& weights = m_graph.cross_weights[m_graph.index(i, j)];
+						if (previous && !chains.window_dirty(top_left)
+							&& !chains.curve_dirty(top_left, BOTTOM_RIGHT) && !chains.curve_dirty(top_right, BOTTOM_LEFT))
+							weights = previous->cross_weights.at(m_graph.index(i, j));
+						else {
+							weights = heuristic_weights(chains, top_left);
+							recomputed = true;
+						}
+
+						//Remove lighter edge, or both if equality (no else if)
+						if (weights[0] <= weights[1])
+						{
+							delete_edge(top_left, BOTTOM_RIGHT);
+							delete_edge(bottom_right, TOP_LEFT);
+							chains.edge_removed(top_left, bottom_right);
+							weights[0] = 0; // deleted edge weighs 0
+						}
+						if (weights[0] >= weights[1])
+						{
+							delete_edge(top_right, BOTTOM_LEFT);
+							delete_edge(bottom_left, TOP_RIGHT);
+							chains.edge_removed(top_right, bottom_left);
+						}
+					}
+				}
+
+				// From now on, square pixels differ from previous compute if diagonals left differ
+				if (previous && (recomputed || chains.dirty(top_left) || chains.dirty(bottom_right)
+					|| chains.dirty(bottom_left) || chains.dirty(top_right))) {
+					std::array<bool, 2> diagonals = { edge(top_left, BOTTOM_RIGHT), edge(bottom_left, TOP_RIGHT) };
+					if (diagonals != resolved_diagonals(*previous, top_left))
+						for (const IntPoint& p : s)
+							chains.set_dirty(p);
+				}
+			}
+		}
+	}
+
+
+	/* Parallel crossing resolution.
+	* Squares are numbered in the order the serial loop above goes through them. Only crossing squares
+	* with no additional connection (heuristic squares) depend on the graph state : when the serial loop
+	* reaches square n, squares before n are resolved and squares after n are untouched.
+	* SquareView gives exactly that state to square n whatever has been done by other threads, reading
+	* the result of earlier heuristic squares once they are resolved. If one is not resolved yet, square n
+	* is stalled and done again at the end, in order. Results are thus the same as the serial loop.
+	* Heuristics only look 3 squares away, except curves. Squares are grouped in tiles, and tiles run in
+	* waves so that every tile a tile looks at is done before, leaving very few stalled squares.
+	*/
+	namespace {
+		// Square states during compute_parallel
+		enum : uint8_t {
+			SQUARE_STATIC = 0, // no cross, or cross with additional connection : never changes
+			SQUARE_TRIVIAL = 1, // cross in fully connected square : both diagonals removed
+			SQUARE_HEURISTIC = 2, // cross resolved by heuristics
+			SQUARE_TYPE = 3,
+			SQUARE_RESOLVED = 1 << 2, // heuristic square done, keep flags valid
+			SQUARE_KEEP = 1 << 3 // SQUARE_KEEP << i : ith diagonal is kept (0 : top_left <-> bottom_right)
+		};
+
+		const size_t square_tile_size = 32;
+
+		// Square and index (0 : top_left <-> bottom_right, 1 : top_right <-> bottom_left) of
+		// the diagonal from p in kth direction. Returns false if k is not a diagonal.
+		bool diagonal_square(const IntPoint& p, Direction k, IntPoint& top_left, size_t& diagonal) {
+			switch (k) {
+			case TOP_LEFT:
+				top_left = p + VecDir[TOP_LEFT];
+				diagonal = 0;
+				return true;
+			case BOTTOM_RIGHT:
+				top_left = p;
+				diagonal = 0;
+				return true;
+			case BOTTOM_LEFT:
+				top_left = p + VecDir[LEFT];
+				diagonal = 1;
+				return true;
+			case TOP_RIGHT:
+				top_left = p + VecDir[TOP];
+				diagonal = 1;
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// Graph as the serial loop sees it when reaching square current
+		class SquareView {
+			const PixelGraph& m_graph;
+			const std::atomic<uint8_t>* m_states;
+			sf::Vector2u m_dim;
+			size_t m_current;
+			mutable bool m_stalled;
+
+		public:
+			SquareView(const PixelGraph& graph, const std::atomic<uint8_t>* states, size_t current) :
+				m_graph(graph), m_states(states), m_dim(graph.getGraph().dim), m_current(current), m_stalled(false)
+			{}
+
+			// true if an earlier square was not resolved yet : results are meaningless
+			bool stalled() const { return m_stalled; }
+
+			bool edge(const IntPoint& p, Direction k) const {
+				// Once stalled, graph is empty so that curve walks end right away
+				// instead of going through an inconsistent graph.
+				// Graph itself is not modified before all squares are resolved.
+				if (m_stalled || !m_graph.edge(p, k))
+					return false;
+				IntPoint top_left;
+				size_t diagonal;
+				if (!diagonal_square(p, k, top_left, diagonal))
+					return true;
+				size_t square = static_cast<size_t>(top_left.x) * (m_dim.y - 1) + static_cast<size_t>(top_left.y);
+				if (square >= m_current)
+					return true;
+				uint8_t state = m_states[square].load(std::memory_order_acquire);
+				switch (state & SQUARE_TYPE) {
+				case SQUARE_TRIVIAL:
+					return false;
+				case SQUARE_HEURISTIC:
+					if (!(state & SQUARE_RESOLVED)) {
+						m_stalled = true;
+						return true;
 					}
+					return (state & (SQUARE_KEEP << diagonal)) != 0;
+				default:
+					return true;
+				}
+			}
+
+			neighbour_mask mask(const IntPoint& p) const {
+				if (m_stalled)
+					return 0;
+				// only diagonals may differ from the graph
+				neighbour_mask bits = m_graph.getGraph()(p.x, p.y);
+				for (int k = TOP_LEFT; k < NUM_DIR; k += 2)
+					if ((bits & (1 << k)) && !edge(p, static_cast<Direction>(k)))
+						bits &= static_cast<neighbour_mask>(~(1u << k));
+				return bits;
+			}
 
+			int valence(const IntPoint& p) const {
+				return mask_valence[mask(p)];
+			}
+		};
+	}
+
+	void PixelGraph::compute_parallel(unsigned threads)
+	{
+		if (dim.x < 2 || dim.y < 2)
+			return;
+		const size_t cols = dim.x - 1;
+		const size_t rows = dim.y - 1;
+		const size_t count = cols * rows;
+		std::vector<std::atomic<uint8_t>> states(count);
+		std::vector<diagonal_weights> weights(count);
+		ThreadPool pool(threads);
+
+		// Square types only depend on the initial graph
+		pool.parallel_for(cols, [&](size_t i) {
+			for (size_t j = 0; j < rows; j++) {
+				IntPoint top_left(static_cast<int>(i), static_cast<int>(j));
+				uint8_t type = SQUARE_STATIC;
+				if (cross(top_left)) {
+					int test = additional_connections(top_left);
+					type = test == 15 ? SQUARE_TRIVIAL : test == 0 ? SQUARE_HEURISTIC : SQUARE_STATIC;
 				}
+				states[i * rows + j].store(type, std::memory_order_relaxed);
 			}
+		});
+
+		// Returns false if stalled
+		auto resolve = [&](size_t square) {
+			IntPoint top_left(static_cast<int>(square / rows), static_cast<int>(square % rows));
+			SquareView view(*this, states.data(), square);
+			diagonal_weights w = heuristic_weights(view, top_left);
+			if (view.stalled())
+				return false;
+			// same outcome as serial loop : on equality only top_left diagonal is removed
+			uint8_t keep = w[0] > w[1] ? SQUARE_KEEP : SQUARE_KEEP << 1;
+			if (w[0] <= w[1])
+				w[0] = 0;
+			weights[square] = w;
+			states[square].store(SQUARE_HEURISTIC | SQUARE_RESOLVED | keep, std::memory_order_release);
+			return true;
+		};
+
+		// Tile (X,Y) runs in wave Y + 2X : tiles (X-1,Y-1), (X-1,Y), (X-1,Y+1) and (X,Y-1) are done before
+		const size_t tiles_x = (cols + square_tile_size - 1) / square_tile_size;
+		const size_t tiles_y = (rows + square_tile_size - 1) / square_tile_size;
+		std::vector<std::vector<size_t>> stalled(tiles_x * tiles_y);
+		for (size_t wave = 0; wave < tiles_y + 2 * (tiles_x - 1); wave++) {
+			size_t first_x = wave + 2 > tiles_y ? (wave + 2 - tiles_y) / 2 : 0;
+			size_t last_x = std::min(tiles_x - 1, wave / 2);
+			if (first_x > last_x)
+				continue;
+			pool.parallel_for(last_x - first_x + 1, [&](size_t t) {
+				size_t X = first_x + t;
+				size_t Y = wave - 2 * X;
+				auto& tile_stalled = stalled[X * tiles_y + Y];
+				size_t i_end = std::min(cols, (X + 1) * square_tile_size);
+				size_t j_end = std::min(rows, (Y + 1) * square_tile_size);
+				for (size_t i = X * square_tile_size; i < i_end; i++)
+					for (size_t j = Y * square_tile_size; j < j_end; j++) {
+						size_t square = i * rows + j;
+						if ((states[square].load(std::memory_order_relaxed) & SQUARE_TYPE) == SQUARE_HEURISTIC
+							&& !resolve(square))
+							tile_stalled.push_back(square);
+					}
+			});
 		}
+
+		// Stalled squares in order. Everything before them is resolved now.
+		std::vector<size_t> remaining;
+		for (auto& tile_stalled : stalled)
+			remaining.insert(remaining.end(), tile_stalled.begin(), tile_stalled.end());
+		std::sort(remaining.begin(), remaining.end());
+		for (size_t square : remaining)
+			resolve(square);
+
+		// Apply results. Each pixel gathers its diagonals from its 4 squares.
+		auto removed = [&](int x, int y, int diagonal) {
+			if (x < 0 || y < 0 || static_cast<size_t>(x) >= cols || static_cast<size_t>(y) >= rows)
+				return false;
+			uint8_t state = states[static_cast<size_t>(x) * rows + static_cast<size_t>(y)].load(std::memory_order_relaxed);
+			switch (state & SQUARE_TYPE) {
+			case SQUARE_TRIVIAL:
+				return true;
+			case SQUARE_HEURISTIC:
+				return !(state & (SQUARE_KEEP << diagonal));
+			default:
+				return false;
+			}
+		};
+		pool.parallel_for(dim.x, [&](size_t i) {
+			int x = static_cast<int>(i);
+			for (int y = 0; y < static_cast<int>(dim.y); y++) {
+				neighbour_mask remove = removed(x, y, 0) << BOTTOM_RIGHT
+					| removed(x - 1, y - 1, 0) << TOP_LEFT
+					| removed(x, y - 1, 1) << TOP_RIGHT
+					| removed(x - 1, y, 1) << BOTTOM_LEFT;
+				m_graph(x, y) &= ~remove;
+			}
+		});
+
+		for (size_t square = 0; square < count; square++)
+			if ((states[square].load(std::memory_order_relaxed) & SQUARE_TYPE) == SQUARE_HEURISTIC)
+				m_graph.cross_weights[m_graph.index(static_cast<int>(square / rows), static_cast<int>(square % rows))] = weights[square];
 	}
 
 
 	// Returns true if there is an edge from (x,y) in kth direction
 	bool PixelGraph::edge(int x, int y, Direction k) const
 	{
-		return m_graph[x][y][static_cast<int>(k)] != 0;
+		return (m_graph(x, y) >> static_cast<int>(k)) & 1;
 	}
 
 	bool PixelGraph::edge(const IntPoint& p, Direction k) const
 	{
-		if (isValid(p, dim))
-			return edge(p.x, p.y, k);
-		return false;
+		// no edge on the border around the image
+		return edge(p.x, p.y, k);
+	}
+
+	int PixelGraph::weight(int x, int y, Direction k) const
+	{
+		if (!edge(x, y, k))
+			return 0;
+		// diagonal edges are stored from the top_left pixel of their square
+		IntPoint top_left;
+		size_t diagonal;
+		if (!diagonal_square(IntPoint(x, y), k, top_left, diagonal))
+			return 1;
+		auto it = m_graph.cross_weights.find(m_graph.index(top_left.x, top_left.y));
+		if (it == m_graph.cross_weights.end())
+			return 1;
+		return it->second[diagonal];
 	}
 
 	// Deletes edge
 	void PixelGraph::delete_edge(int x, int y, Direction k) {
-		m_graph[x][y][static_cast<int>(k)] = 0;
+		m_graph(x, y) &= static_cast<neighbour_mask>(~(1u << k));
 	}
 
 	void PixelGraph::delete_edge(const IntPoint& p, Direction k)
@@ -0,0 +1,223 @@
+#include <PixelArt/smoothing.h>
+#include <PixelArt/thread_pool.h>
+#include <algorithm>
+#include <cmath>
+
+namespace pa {
+
+	namespace {
+		constexpr int curvature_samples = 4;
+
+		// offsets tried around a point, times the step
+		const std::array<Point, 8> relax_dirs{
+			Point(1.0f, 0.0f), Point(0.7071068f, 0.7071068f), Point(0.0f, 1.0f), Point(-0.7071068f, 0.7071068f),
+			Point(-1.0f, 0.0f), Point(-0.7071068f, -0.7071068f), Point(0.0f, -1.0f), Point(0.7071068f, -0.7071068f)
+		};
+
+		float cross(const Point& a, const Point& b) { return a.x * b.y - a.y * b.x; }
+		float dot(const Point& a, const Point& b) { return a.x * b.x + a.y * b.y; }
+
+		// Curvature of a quadratic B-spline segment, sampled at fixed parameters. Its second
+		// derivative b - a is constant, so the curvature is |a x b| / |a + t (b - a)|^3.
+		float segmentEnergy(const Point& p0, const Point& p1, const Point& p2) {
+			Point a = p1 - p0;
+			Point b = p2 - p1;
+			float c = std::fabs(cross(a, b));
+			if (c == 0.0f) return 0.0f;
+			float sum = 0.0f;
+			for (int k = 0; k < curvature_samples; k++) {
+				float t = (static_cast<float>(k) + 0.5f) / curvature_samples;
+				Point d = a + t * (b - a);
+				float length2 = dot(d, d);
+				sum += c / (length2 * std::sqrt(length2));
+			}
+			return sum / curvature_samples;
+		}
+
+		// Distinct points of one curve, worked on in place
+		struct CurvePoints {
+			Point* points;
+			const Point* initial;
+			const uint8_t* fixed;
+			size_t size;
+			bool closed;
+
+			// next point of the control polygon, fixed points being repeated
+			size_t next(size_t i) const {
+				if (fixed[i]) return i;
+				return closed ? (i + 1) % size : i + 1;
+			}
+			size_t previous(size_t i) const {
+				if (fixed[i]) return i;
+				return closed ? (i + size - 1) % size : i - 1;
+			}
+
+			// terms of the energy depending on free point i : the three segments it
+			// is a control point of, and its distance to its start
+			float energy(size_t i) const {
+				size_t p1 = previous(i), p2 = previous(p1);
+				size_t n1 = next(i), n2 = next(n1);
+				Point d = points[i] - initial[i];
+				float d2 = dot(d, d);
+				return segmentEnergy(points[p2], points[p1], points[i])
+					+ segmentEnergy(points[p1], points[i], points[n1])
+					+ segmentEnergy(points[i], points[n1], points[n2])
+					+ d2 * d2;
+			}
+		};
+	}
+
+	void SplineControls::clear() {
+		points.clear();
+		fixed.clear();
+	}
+
+
+	CurveSmoother::CurveSmoother(SmoothingParam p) :
+		m_curves(nullptr),
+		m_param(p)
+	{
+	}
+
+	void CurveSmoother::setCurves(const CurveExtractor& curves) {
+		m_curves = &curves;
+	}
+
+	void CurveSmoother::setParam(const SmoothingParam& p) {
+		m_param = p;
+	}
+
+	void CurveSmoother::findCorners(size_t c) {
+		const CurveList& list = m_curves->getCurves();
+		size_t first = list.offsets[c];
+		bool closed = list.closed[c];
+		size_t n = list.offsets[c + 1] - first - closed;
+		const Point* p = &m_initial[first];
+		uint8_t* fixed = &m_controls.fixed[first];
+
+		if (closed && n < 3) {
+			std::fill_n(fixed, n + 1, 1);
+			return;
+		}
+		if (!closed) fixed[0] = fixed[n - 1] = 1;
+
+		// turn of the curve at each point, none at the ends of open curves
+		auto turn = [p, n, closed](size_t i, float& turn_dot) {
+			if (!closed && (i == 0 || i == n - 1)) {
+				turn_dot = 1.0f;
+				return 0.0f;
+			}
+			Point in = p[i] - p[(i + n - 1) % n];
+			Point out = p[(i + 1) % n] - p[i];
+			turn_dot = dot(in, out);
+			return cross(in, out);
+		};
+		for (size_t i = 0; i < n; i++) {
+			float turn_dot, side_dot;
+			float side = turn(i, turn_dot);
+			if (turn_dot < 0.0f) {
+				fixed[i] = 1;
+			}
+			else if (turn_dot == 0.0f && side != 0.0f) {
+				float before = turn((i + n - 1) % n, side_dot);
+				float after = turn((i + 1) % n, side_dot);
+				fixed[i] |= !(before * side < 0.0f || after * side < 0.0f);
+			}
+		}
+		if (closed) fixed[n] = fixed[0];
+	}
+
+	void CurveSmoother::relax(size_t c) {
+		const CurveList& list = m_curves->getCurves();
+		size_t first = list.offsets[c];
+		bool closed = list.closed[c];
+		CurvePoints curve{ &m_controls.points[first], &m_initial[first], &m_controls.fixed[first],
+			list.offsets[c + 1] - first - closed, closed };
+
+		float step = m_param.step;
+		for (int iteration = 0; iteration < m_param.max_iterations; iteration++) {
+			// energy around the free points before moving them, and how much moving lowered it
+			float energy = 0.0f, decrease = 0.0f;
+			for (size_t i = 0; i < curve.size; i++) {
+				if (curve.fixed[i]) continue;
+				Point start = curve.points[i];
+				float start_energy = curve.energy(i);
+				float best_energy = start_energy;
+				Point best = start;
+				for (const Point& dir : relax_dirs) {
+					curve.points[i] = start + step * dir;
+					float e = curve.energy(i);
+					if (e < best_energy) {
+						best_energy = e;
+						best = curve.points[i];
+					}
+				}
+				curve.points[i] = best;
+				energy += start_energy;
+				decrease += start_energy - best_energy;
+			}
+
+			if (decrease == 0.0f) {
+				// try closer
+				step *= 0.5f;
+				if (step < m_param.min_step) break;
+			}
+			else if (decrease < m_param.tolerance * energy) {
+				break;
+			}
+		}
+		if (closed) curve.points[curve.size] = curve.points[0];
+	}
+
+	void CurveSmoother::compute(unsigned threads) {
+		const CurveList& list = m_curves->getCurves();
+		const VoronoiMesh& mesh = m_curves->getDiagram()->getDiagram();
+		m_initial.resize(list.vertices.size());
+		for (size_t i = 0; i < m_initial.size(); i++)
+			m_initial[i] = to_point(mesh.vertices[list.vertices[i]]);
+		m_controls.points = m_initial;
+		m_controls.fixed.assign(m_initial.size(), 0);
+
+		// curves are independent
+		ThreadPool pool(threads);
+		pool.parallel_for(list.size(), [this](size_t c) {
+			findCorners(c);
+			relax(c);
+		});
+	}
+
+	const SplineControls& CurveSmoother::getControls() const {
+		return m_controls;
+	}
+
+	void CurveSmoother::appendSplines(QuadraticBSpline& splines) const {
+		const CurveList& list = m_curves->getCurves();
+		std::vector<Point> polygon;
+		for (size_t c = 0; c < list.size(); c++) {
+			size_t first = list.offsets[c];
+			bool closed = list.closed[c];
+			size_t n = list.offsets[c + 1] - first - closed;
+			const Point* p = &m_controls.points[first];
+			const uint8_t* fixed = &m_controls.fixed[first];
+
+			// pieces go from a fixed point to the next one, all around closed curves
+			size_t start = static_cast<size_t>(std::find(fixed, fixed + n, 1) - fixed);
+			if (start == n) {
+				splines.append(p, n, true);
+				continue;
+			}
+			size_t steps = closed ? n : n - 1;
+			polygon.assign(2, p[start]);
+			for (size_t k = 1; k <= steps; k++) {
+				size_t i = (start + k) % n;
+				polygon.push_back(p[i]);
+				if (fixed[i]) {
+					polygon.push_back(p[i]);
+					splines.append(polygon.data(), polygon.size(), false);
+					polygon.assign(2, p[i]);
+				}
+			}
+		}
+	}
+
+}
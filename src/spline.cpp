@@ -1,163 +1,63 @@
-#include "spline.h"
-#include "voronoi.h"
-
-
-
-//Returns the darker pixel by Y luminescence value -> A MODIFIER
-Pixel* darker(Pixel* a, Pixel* b)
-{
-    ColorYUV color1 = a->color();
-    ColorYUV color2 = b->color();
-    if(color1.Y < color2.Y) return a;
-    else return b;
-}
-
-
-
-//Extracts active edges from voronoi diagrams
-void Spline::fillActiveEdges()
-{
-    if(this->diagram == nullptr) return;
-    
-    //For keeping the edges detected till now.
-    std::map<Edge,Pixel*> edgeEnum;
-
-    //Get image dimensions
-    Image* imageRef = this->diagram->getImage(); 
-    int width = imageRef->getWidth();
-    int height = imageRef->getHeight();
-
-    for(int x=0; x <width; x++)
-    {
-        for(int y=0; y< height; y++)
-        {
-            for(int i = 0 ; i < (*this->diagram)(x,y).size(); i++) 
-            {
-
-                //Looping over the voronoi hull, of point (x,y), we find the edges which have different colored pixels on either side, and add to active edges.
-                int l = i;
-                int r = (i+1)%((*this->diagram)(x,y).size());
-                if(edgeEnum.find(make_pair((*this->diagram)(x,y)[r],(*this->diagram)(x,y)[l])) != edgeEnum.end()) 
-                {
-                    auto p = edgeEnum[make_pair((*this->diagram)(x,y)[r],(*this->diagram)(x,y)[l])];
-                    if(p != (*imageRef)(x,y) && !(p->color() == (*imageRef)(x,y)->color())) activeEdges.push_back(make_pair(make_pair((*this->diagram)(x,y)[l],(*this->diagram)(x,y)[r]),darker(p,(*imageRef)(x,y)))); 
-                }
-                else edgeEnum[std::make_pair((*this->diagram)(x,y)[l],(*this->diagram)(x,y)[r])] = (*imageRef)(x,y);
-            }
-        }
-    }
-}
-
-void Spline::fillGraph()
-{
-    for(auto edge : activeEdges)
-    {
-        auto P1 = std::make_pair(edge.first.second,edge.second->color());
-        auto P2 = std::make_pair(edge.first.first,edge.second->color());
-
-        const auto x = edge.first;
-
-        graph[x.first].insert(P1);
-        graph[x.second].insert(P2);
-    }
-}
-
-//A MODIFIER
-std::vector<std::pair<std::vector<Point>,Color> > Spline::printGraph()
-{
-    //Tracing curves. Starting with a random node, We trace out a curve with same colors
-    std::vector<std::pair<std::vector<Point>, Color> > mainOutLine;
-    std::map<Point, std::set<std::pair<Point,Color> > >::iterator vertexPt = graph.begin();
-    while(vertexPt != graph.end())
-    {
-        while((vertexPt->second).size() > 0)
-        {
-            Point src = (vertexPt->second).begin()->first;
-            Color c = (vertexPt->second).begin()->second;
-            std::vector<Point> v = traverseGraph(src, c);
-            mainOutLine.push_back(std::make_pair(v,c));
-        }
-        vertexPt ++;
-    }
-    return mainOutLine;
+#include <PixelArt/spline.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PA_SPLINE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define PA_SPLINE_SSE2
+#endif
+
+namespace pa {
+
+	// Kernels below use Horner's scheme from the highest coefficient, with a separate
+	// multiply and add, in the same order as the remaining polynomials and BSpline::operator().
+
+#if defined(PA_SPLINE_AVX2)
+	// 8 polynomials per iteration. Returns number of polynomials evaluated.
+	static size_t evaluateBlock(const float* const* coefs, int order, size_t count, float t, float* out)
+	{
+		const __m256 vt = _mm256_set1_ps(t);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256 v = _mm256_loadu_ps(coefs[order - 1] + i);
+			for (int j = order - 2; j >= 0; j--)
+				v = _mm256_add_ps(_mm256_mul_ps(v, vt), _mm256_loadu_ps(coefs[j] + i));
+			_mm256_storeu_ps(out + i, v);
+		}
+		return i;
+	}
+#elif defined(PA_SPLINE_SSE2)
+	// 4 polynomials per iteration. Returns number of polynomials evaluated.
+	static size_t evaluateBlock(const float* const* coefs, int order, size_t count, float t, float* out)
+	{
+		const __m128 vt = _mm_set1_ps(t);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 v = _mm_loadu_ps(coefs[order - 1] + i);
+			for (int j = order - 2; j >= 0; j--)
+				v = _mm_add_ps(_mm_mul_ps(v, vt), _mm_loadu_ps(coefs[j] + i));
+			_mm_storeu_ps(out + i, v);
+		}
+		return i;
+	}
+#else
+	static size_t evaluateBlock(const float* const*, int, size_t, float, float*)
+	{
+		return 0;
+	}
+#endif
+
+	void evaluatePolynomials(const float* const* coefs, int order, size_t count, float t, float* out)
+	{
+		size_t i = evaluateBlock(coefs, order, count, t, out);
+
+		// remaining polynomials
+		for (; i < count; i++) {
+			float v = coefs[order - 1][i];
+			for (int j = order - 2; j >= 0; j--)
+				v = v * t + coefs[j][i];
+			out[i] = v;
+		}
+	}
 }
-
-
-
-//ALGORITHM FROM https://www.programiz.com/dsa/graph-bfs
-//A RECODER !!
-std::vector<Point> Spline::traverseGraph(const Point& q,const Color& c)
-{
-    std::vector<Point> visited;
-    Point current_point = q;
-    Point prev = Point(-1,-1);
-    Color curr = c;
-    bool found=true;
-
-    while(found)
-    {
-        visited.push_back(current_point);
-        for(auto it = graph[x].begin();it!=graph[x].end();it++)
-        {
-            if(it->first == prev) continue;
-            if(it->second == c)
-            {
-                Point p2 = it->first;
-                std::set<std::pair<Point,Color>>::iterator it1;
-                for(it1 = graph[p2].begin();it1!=graph[p2].end();it1++){
-                    if(curr == it1 -> second){
-                        if(it1->first==current_point) break;
-                    }
-                }
-
-                if(it1 == graph[p2].end()) break;
-                curr = it -> second;
-                graph[current_point].erase(it);
-                graph[p2].erase(it1)
-
-                current_point = p2;
-                found = True;:
-                break;
-            }
-
-        }
-        if(!found) break;
-        found = false;
-    }
-
-    if(visited.size() > 2 && *visited.begin() == *visited.rbegin()){
-        visited.push_back(visited[1]);
-    }
-    return visited;
-}
-
-
-//TRANSFORME OK
-std::vector<std::vector<float> > Spline::getSpline(std::vector<Point> points) // For 3 points
-{
-    assert(points.size()==3);
-
-    //Basis Matrix for spline interpolation with quadratic norm
-    std::vector<std::vector<float>> M = {{1/2, 1/2, 0},{ -1, 1, 0},{1/2, -1, 1/2}};
-
-    //initialize the vector vec
-    std::vector<std::vector<float>> vec(3, std::vector<float>(2,0.0));
-
-    //iterate using B-spline matrix
-    for(int i = 0 ; i < 3; i++)
-    {
-        for(int j = 0; j < 2; j++)
-        {
-            for(int k = 0 ; k < 3; k ++) 
-            {
-                if(j == 0){
-                    vec[i][j] +=  M[i][k]*points[k].first;
-                }
-                if(j==1){
-                    vec[i][j] += M[i][k]*points[k].second;
-                }
-            }
-        }
-    }
-    return vec;
-}
\ No newline at end of file
@@ -121,7 +121,7 @@ int main(int argc, char* argv[])
         for (int i = 0; i < dim.x; i++) {
             for (int j = 0; j < dim.y; j++) {
                 for (int k = 0; k < pa::NUM_DIR; k++) {
-                    if (edges[i][j][k]) {
+                    if (edges(i, j) & (1 << k)) {
                         auto dir = pa::VecDir[k];
                         line[0].position = scale * sf::Vector2f(i + 0.5f, j + 0.5f);
                         line[1].position = scale * sf::Vector2f(i + 0.5f + dir.x, j + 0.5f + dir.y);
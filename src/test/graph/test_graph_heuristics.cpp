@@ -0,0 +1,170 @@
+#include <array>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <PixelArt/pixel_graph.h>
+#include "../regression.h"
+
+// Tests of the crossing heuristics against plain implementations, without window :
+// memoized chain lengths against the step by step curve walk while edges are deleted,
+// and the bitboard flood fill of the sparse pixels heuristic against a breadth first search.
+
+namespace pa {
+	// Friend of PixelGraph, reaching its heuristics
+	struct PixelGraphTest {
+		// Deletes random edges of the graph one at a time, as crossing resolution does, and
+		// compares the chain length of every edge with the walk after each deletion.
+		// Returns the number of mismatches.
+		static int chainLengths(PixelGraph& graph, unsigned deletions, unsigned seed) {
+			const int width = static_cast<int>(graph.dim.x), height = static_cast<int>(graph.dim.y);
+			PixelGraph::CurveChains chains(graph);
+			auto compare = [&]() {
+				int mismatches = 0;
+				for (int x = 0; x < width; x++)
+					for (int y = 0; y < height; y++)
+						for (int k = 0; k < NUM_DIR; k++) {
+							IntPoint p(x, y);
+							Direction d = static_cast<Direction>(k);
+							if (graph.edge(p, d) && chains.curve_edges(p, d) != graph.count_curve_edges(graph, p, d))
+								mismatches++;
+						}
+				return mismatches;
+			};
+
+			std::mt19937 rng(seed);
+			int mismatches = compare();
+			for (unsigned i = 0; i < deletions; i++) {
+				IntPoint p(static_cast<int>(rng() % graph.dim.x), static_cast<int>(rng() % graph.dim.y));
+				Direction d = static_cast<Direction>(rng() % NUM_DIR);
+				if (!graph.edge(p, d))
+					continue;
+				IntPoint q(p + VecDir[d]);
+				graph.delete_edge(p, d);
+				graph.delete_edge(q, opposite(d));
+				chains.edge_removed(p, q);
+				mismatches += compare();
+			}
+			return mismatches;
+		}
+
+		// Component sizes of the sparse pixels heuristic for square top_left, whose 8x8 window
+		// gets the given masks, window[8 * gx + gy] being pixel (top_left.x - 3 + gx, top_left.y - 3 + gy)
+		static diagonal_weights windowSizes(PixelGraph& graph, const IntPoint& top_left, const std::array<neighbour_mask, 64>& window) {
+			for (int gx = 0; gx < 8; gx++)
+				for (int gy = 0; gy < 8; gy++)
+					graph.m_graph(top_left.x - 3 + gx, top_left.y - 3 + gy) = window[static_cast<size_t>(8 * gx + gy)];
+			PixelGraph::CurveChains chains(graph);
+			diagonal_weights sizes = { 0, 0 };
+			graph.sparse_pixels_heuristic(chains, top_left, sizes);
+			return sizes;
+		}
+	};
+}
+
+namespace {
+	using pa::Direction; // for NUM_DIR
+	using Window = std::array<pa::neighbour_mask, 64>;
+
+	// Pixels of the window reachable from (gx, gy) without leaving it, marked in seen
+	int component(const Window& window, int gx, int gy, std::array<bool, 64>& seen) {
+		std::vector<pa::IntPoint> stack{ pa::IntPoint(gx, gy) };
+		seen[static_cast<size_t>(8 * gx + gy)] = true;
+		int size = 0;
+		while (!stack.empty()) {
+			pa::IntPoint p = stack.back();
+			stack.pop_back();
+			size++;
+			for (size_t k = 0; k < NUM_DIR; k++) {
+				pa::IntPoint n = p + pa::VecDir[k];
+				size_t i = static_cast<size_t>(8 * n.x + n.y);
+				if (!(window[static_cast<size_t>(8 * p.x + p.y)] >> k & 1) || n.x < 0 || n.y < 0 || n.x > 7 || n.y > 7 || seen[i])
+					continue;
+				seen[i] = true;
+				stack.push_back(n);
+			}
+		}
+		return size;
+	}
+
+	// Sizes the heuristic adds : component of top_left, then of top_right among the others,
+	// top_right alone if both are connected
+	pa::diagonal_weights windowSizes(const Window& window) {
+		std::array<bool, 64> seen{};
+		int sizeA = component(window, 3, 3, seen);
+		if (seen[8 * 4 + 3])
+			return { sizeA - 1, 1 };
+		return { sizeA, component(window, 4, 3, seen) };
+	}
+
+	// Random edges of the 10x10 pixels around an 8x8 window, set in both directions, so
+	// that some leave the window. Edges are in the window masks only.
+	Window randomWindow(std::mt19937& rng, unsigned density) {
+		Window window{};
+		for (int x = -1; x < 9; x++)
+			for (int y = -1; y < 9; y++)
+				for (size_t k = 0; k < 4; k++) {
+					pa::Direction d = static_cast<pa::Direction>(k);
+					pa::IntPoint n = pa::IntPoint(x, y) + pa::VecDir[k];
+					if (rng() % 100 >= density)
+						continue;
+					if (x >= 0 && y >= 0 && x < 8 && y < 8)
+						window[static_cast<size_t>(8 * x + y)] |= static_cast<pa::neighbour_mask>(1u << d);
+					if (n.x >= 0 && n.y >= 0 && n.x < 8 && n.y < 8)
+						window[static_cast<size_t>(8 * n.x + n.y)] |= static_cast<pa::neighbour_mask>(1u << pa::opposite(d));
+				}
+		return window;
+	}
+}
+
+
+int main()
+{
+	using pa::test::check;
+	std::cout << "Starting heuristics tests on graph" << std::endl;
+
+	// loose thresholds give long chains, cycles and many crossings
+	const std::vector<sf::Vector2u> sizes{ { 40, 30 }, { 17, 23 }, { 1, 9 } };
+	for (size_t i = 0; i < sizes.size(); i++) {
+		sf::Image image = pa::test::makeImage(sizes[i].x, sizes[i].y, static_cast<unsigned>(i + 31));
+		std::string name = std::to_string(sizes[i].x) + "x" + std::to_string(sizes[i].y);
+		for (const pa::ColorYUV& color : { pa::ColorYUV(42.0f, 7.0f, 6.0f), pa::ColorYUV(120.0f, 40.0f, 40.0f) }) {
+			pa::PixelGraph graph{ pa::PixelGraphParam(image, color) };
+			int mismatches = pa::PixelGraphTest::chainLengths(graph, 1500, static_cast<unsigned>(i));
+			check(mismatches == 0, name + " at Y " + std::to_string(color.Y) + " : " + std::to_string(mismatches) + " chain lengths differ from the walk");
+		}
+	}
+
+	// Windows of several densities at every position in a small graph, the border included.
+	// Counts edges leaving the window in each direction, and crossing a column end inside it.
+	sf::Image image = pa::test::makeImage(12, 12, 41);
+	pa::PixelGraph graph{ pa::PixelGraphParam(image) };
+	std::mt19937 rng(7);
+	std::array<int, NUM_DIR> leaving{};
+	int wrapping = 0, mismatches = 0;
+	for (unsigned density : { 10u, 25u, 45u, 70u, 95u }) {
+		for (int x = 0; x <= 10; x++) {
+			for (int y = 0; y <= 10; y++) {
+				Window window = randomWindow(rng, density);
+				mismatches += pa::PixelGraphTest::windowSizes(graph, pa::IntPoint(x, y), window) != windowSizes(window);
+				for (int gx = 0; gx < 8; gx++)
+					for (int gy = 0; gy < 8; gy++)
+						for (size_t k = 0; k < NUM_DIR; k++) {
+							if (!(window[static_cast<size_t>(8 * gx + gy)] >> k & 1))
+								continue;
+							pa::IntPoint n = pa::IntPoint(gx, gy) + pa::VecDir[k];
+							if (n.x < 0 || n.y < 0 || n.x > 7 || n.y > 7)
+								leaving[k]++;
+							if ((n.y < 0 || n.y > 7) && n.x >= 0 && n.x <= 7)
+								wrapping++;
+						}
+			}
+		}
+	}
+	check(mismatches == 0, "sparse pixels window : " + std::to_string(mismatches) + " sizes differ from the search");
+	for (size_t k = 0; k < NUM_DIR; k++)
+		check(leaving[k] > 0, "sparse pixels window : edges leaving in direction " + std::to_string(k));
+	check(wrapping > 0, "sparse pixels window : edges past a column end");
+
+	return pa::test::report("heuristics");
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <PixelArt/pixel_graph.h>
+#include "../regression.h"
+
+// Regression tests of the similarity graph, without window : threaded compute and update
+// must give the same graph as a serial compute.
+
+namespace {
+	bool sameGraph(const pa::PixelGraph& a, const pa::PixelGraph& b) {
+		return a.getGraph().masks == b.getGraph().masks
+			&& a.getGraph().cross_weights == b.getGraph().cross_weights
+			&& a.getCellTypes() == b.getCellTypes();
+	}
+}
+
+
+int main()
+{
+	using pa::test::check;
+	std::cout << "Starting regression tests on graph" << std::endl;
+
+	// threaded crossing resolution only runs from 64x64 pixels
+	const std::vector<sf::Vector2u> sizes{ { 96, 80 }, { 130, 67 }, { 21, 13 }, { 1, 9 } };
+	for (size_t i = 0; i < sizes.size(); i++) {
+		sf::Image image = pa::test::makeImage(sizes[i].x, sizes[i].y, static_cast<unsigned>(i + 1));
+		std::string name = std::to_string(sizes[i].x) + "x" + std::to_string(sizes[i].y);
+
+		pa::PixelGraph serial{ pa::PixelGraphParam(image) };
+		serial.compute(1);
+		for (unsigned threads : { 2u, 3u, 0u }) {
+			pa::PixelGraph parallel{ pa::PixelGraphParam(image) };
+			parallel.compute(threads);
+			check(sameGraph(serial, parallel), name + " : compute on " + std::to_string(threads) + " threads");
+		}
+
+		// palette lookup tables on threads
+		pa::PixelGraph palette{ pa::PixelGraphParam(image, pa::ColorYUV(42.0f, 7.0f, 6.0f), true) };
+		check(!palette.getPalette().empty(), name + " : palette extracted");
+		palette.compute(3);
+		check(sameGraph(serial, palette), name + " : palette mode on 3 threads");
+
+		// successive updates, each against a new graph with the same thresholds
+		pa::PixelGraph updated{ pa::PixelGraphParam(image) };
+		updated.compute(1);
+		const std::vector<pa::ColorYUV> thresholds{ { 10.0f, 3.0f, 3.0f }, { 60.0f, 9.0f, 9.0f }, { 42.0f, 7.0f, 6.0f }, { 1.0f, 1.0f, 1.0f } };
+		for (const pa::ColorYUV& color : thresholds) {
+			updated.update(color);
+			pa::PixelGraph fresh{ pa::PixelGraphParam(image, color) };
+			fresh.compute(1);
+			check(sameGraph(updated, fresh), name + " : update to Y " + std::to_string(color.Y));
+		}
+
+		// without compute, update only tests the edges again
+		pa::PixelGraph initial{ pa::PixelGraphParam(image) };
+		initial.update(thresholds[0]);
+		pa::PixelGraph fresh{ pa::PixelGraphParam(image, thresholds[0]) };
+		check(sameGraph(initial, fresh), name + " : update before compute");
+	}
+
+	return pa::test::report("graph");
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <PixelArt/interpolation.hpp>
+
+// Regression tests of the batched interpolation : the Thomas solve over all the curves
+// against a dense solve of each natural spline system, and every evaluation path against
+// a scalar evaluation.
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const std::string& what)
+    {
+        if (!ok)
+        {
+            ++failures;
+            std::cout << "FAILED : " << what << std::endl;
+        }
+    }
+
+    // Second derivatives of the natural cubic spline through (x, y), by Gaussian
+    // elimination of the dense system
+    std::vector<double> reference_derivative(const std::vector<double>& x, const std::vector<double>& y)
+    {
+        size_t size = x.size();
+        std::vector<double> y2(size, 0.);
+        if (size < 3)
+        {
+            return y2;
+        }
+        size_t n = size - 2;
+        std::vector<std::vector<double>> a(n, std::vector<double>(n + 1, 0.));
+        for (size_t r = 0; r < n; ++r)
+        {
+            size_t i = r + 1;
+            double hl = x[i] - x[i - 1];
+            double hh = x[i + 1] - x[i];
+            if (r > 0)
+            {
+                a[r][r - 1] = hl;
+            }
+            a[r][r] = 2. * (hl + hh);
+            if (r + 1 < n)
+            {
+                a[r][r + 1] = hh;
+            }
+            a[r][n] = 6. * ((y[i + 1] - y[i]) / hh - (y[i] - y[i - 1]) / hl);
+        }
+        for (size_t r = 0; r < n; ++r)
+        {
+            for (size_t s = r + 1; s < n; ++s)
+            {
+                double f = a[s][r] / a[r][r];
+                for (size_t k = r; k <= n; ++k)
+                {
+                    a[s][k] -= f * a[r][k];
+                }
+            }
+        }
+        for (size_t r = n; r-- > 0;)
+        {
+            double v = a[r][n];
+            for (size_t k = r + 1; k < n; ++k)
+            {
+                v -= a[r][k] * y2[k + 1];
+            }
+            y2[r + 1] = v / a[r][r];
+        }
+        return y2;
+    }
+
+    // Value at t of the piecewise cubic through (x, y) with second derivatives y2,
+    // extrapolated from the end intervals
+    double reference_value(const std::vector<double>& x, const std::vector<double>& y,
+                           const std::vector<double>& y2, double t)
+    {
+        size_t k = 0;
+        while (k + 2 < x.size() && x[k + 1] <= t)
+        {
+            ++k;
+        }
+        double h = x[k + 1] - x[k];
+        double a = (x[k + 1] - t) / h;
+        double b = (t - x[k]) / h;
+        return a * y[k] + b * y[k + 1] + ((a * a * a - a) * y2[k] + (b * b * b - b) * y2[k + 1]) * h * h / 6.;
+    }
+}
+
+int main()
+{
+    std::cout << "Starting regression tests on interpolation" << std::endl;
+
+    using method = hpc::interpolation::method;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> step(0.1, 1.);
+
+    for (size_t knots : { 2u, 3u, 4u, 17u })
+    {
+        for (size_t curves : { 1u, 5u, 33u })
+        {
+            std::string name = std::to_string(curves) + " curves of " + std::to_string(knots) + " knots";
+
+            // knots of each curve, and the same in the batched layout
+            std::vector<std::vector<double>> cx(curves), cy(curves);
+            std::vector<double> x(knots * curves), y(knots * curves);
+            for (size_t c = 0; c < curves; ++c)
+            {
+                double position = -1.;
+                for (size_t i = 0; i < knots; ++i)
+                {
+                    position += step(rng);
+                    cx[c].push_back(position);
+                    cy[c].push_back(std::sin(3. * position) + step(rng));
+                    x[i * curves + c] = cx[c].back();
+                    y[i * curves + c] = cy[c].back();
+                }
+            }
+            hpc::interpolation spline(x, y, curves, method::spline);
+            hpc::interpolation linear(x, y, curves, method::linear);
+            check(spline.curves() == curves && spline.knots() == knots, name + " : sizes");
+
+            // increasing abscissae, beyond both ends
+            std::vector<double> ts(40);
+            for (size_t j = 0; j < ts.size(); ++j)
+            {
+                ts[j] = -2. + 0.03 * static_cast<double>(j * knots);
+            }
+            std::vector<double> resampled(ts.size() * curves), resampled_linear(ts.size() * curves);
+            spline.resample(ts.data(), ts.size(), resampled.data());
+            linear.resample(ts.data(), ts.size(), resampled_linear.data());
+
+            double spline_error = 0., linear_error = 0.;
+            for (size_t c = 0; c < curves; ++c)
+            {
+                std::vector<double> y2 = reference_derivative(cx[c], cy[c]);
+                std::vector<double> zero(knots, 0.);
+                for (size_t j = 0; j < ts.size(); ++j)
+                {
+                    double expected = reference_value(cx[c], cy[c], y2, ts[j]);
+                    spline_error = std::max(spline_error, std::fabs(expected - resampled[j * curves + c]));
+                    spline_error = std::max(spline_error, std::fabs(expected - spline.interpolate(c, ts[j])));
+                    double expected_linear = reference_value(cx[c], cy[c], zero, ts[j]);
+                    linear_error = std::max(linear_error, std::fabs(expected_linear - resampled_linear[j * curves + c]));
+                }
+            }
+
+            // each curve at its own abscissa
+            std::vector<double> own(curves), values(curves);
+            for (size_t c = 0; c < curves; ++c)
+            {
+                own[c] = cx[c].front() + 0.3 * static_cast<double>(c);
+            }
+            spline.interpolate(own.data(), values.data());
+            for (size_t c = 0; c < curves; ++c)
+            {
+                std::vector<double> y2 = reference_derivative(cx[c], cy[c]);
+                spline_error = std::max(spline_error, std::fabs(reference_value(cx[c], cy[c], y2, own[c]) - values[c]));
+            }
+
+            check(spline_error < 1e-9, name + " : spline error " + std::to_string(spline_error));
+            check(linear_error < 1e-12, name + " : linear error " + std::to_string(linear_error));
+        }
+    }
+
+    // a batch without curves
+    hpc::interpolation empty({}, {}, 0, method::spline);
+    double t = 0.;
+    empty.resample(&t, 1, nullptr);
+    empty.interpolate(&t, nullptr);
+    check(empty.curves() == 0 && empty.knots() == 0, "empty batch");
+
+    if (failures)
+    {
+        std::cout << failures << " interpolation check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All interpolation checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <SFML/Graphics/Image.hpp>
+
+namespace pa {
+namespace test {
+
+	// Helpers of the regression tests, which run without window
+
+	// number of failed checks so far
+	inline int failures = 0;
+
+	inline void check(bool ok, const std::string& what) {
+		if (!ok) {
+			failures++;
+			std::cout << "FAILED : " << what << std::endl;
+		}
+	}
+
+	// prints the outcome, returns the exit code of the test program
+	inline int report(const std::string& name) {
+		if (failures) {
+			std::cout << failures << " " << name << " check(s) failed" << std::endl;
+			return 1;
+		}
+		std::cout << "All " << name << " checks passed" << std::endl;
+		return 0;
+	}
+
+	// Pixel art like image : a few colors, rectangles of a color over noise, and some
+	// near colors so that thresholds matter
+	inline sf::Image makeImage(unsigned width, unsigned height, unsigned seed) {
+		std::mt19937 rng(seed);
+		auto random = [&rng](unsigned n) { return static_cast<unsigned>(rng() % n); };
+		auto channel = [&random]() { return static_cast<uint8_t>(random(256)); };
+		std::vector<sf::Color> colors;
+		for (int c = 0; c < 5; c++) {
+			sf::Color color(channel(), channel(), channel());
+			colors.push_back(color);
+			colors.push_back(sf::Color(color.r, static_cast<uint8_t>(color.g ^ 8), color.b));
+		}
+		const unsigned count = static_cast<unsigned>(colors.size());
+		sf::Image image;
+		image.create(width, height, colors[0]);
+		for (unsigned x = 0; x < width; x++)
+			for (unsigned y = 0; y < height; y++)
+				if (random(3) == 0) image.setPixel(x, y, colors[random(count)]);
+		for (int r = 0; r < 20; r++) {
+			unsigned left = random(width), top = random(height);
+			unsigned right = std::min(width, left + 1 + random(12)), bottom = std::min(height, top + 1 + random(12));
+			sf::Color color = colors[random(count)];
+			for (unsigned x = left; x < right; x++)
+				for (unsigned y = top; y < bottom; y++)
+					image.setPixel(x, y, color);
+		}
+		return image;
+	}
+
+}
+}
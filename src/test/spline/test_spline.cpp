@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <PixelArt/smoothing.h>
+#include <PixelArt/spline.h>
+#include "../regression.h"
+
+// Regression tests of the splines, without window : smoothing does not depend on the
+// threads, segments follow the uniform quadratic B-spline of their control points, batched
+// evaluation matches the scalar one, and flattened polylines stay within their tolerance
+// of the curves.
+
+namespace {
+	// Quadratic uniform B-spline through control points a, b, c at t
+	pa::Point quadratic(const pa::Point& a, const pa::Point& b, const pa::Point& c, float t) {
+		float wa = 0.5f * (1.0f - t) * (1.0f - t);
+		float wb = 0.5f + t * (1.0f - t);
+		float wc = 0.5f * t * t;
+		return wa * a + wb * b + wc * c;
+	}
+
+	float distanceToSegment(const pa::Point& p, const pa::Point& a, const pa::Point& b) {
+		pa::Point d = b - a;
+		float length2 = d.x * d.x + d.y * d.y;
+		float t = length2 > 0.0f ? std::clamp(((p.x - a.x) * d.x + (p.y - a.y) * d.y) / length2, 0.0f, 1.0f) : 0.0f;
+		pa::Point q = a + t * d - p;
+		return std::sqrt(q.x * q.x + q.y * q.y);
+	}
+
+	// Largest distance from the scaled curves, sampled, to their polylines. Negative if
+	// a polyline does not start and end with its curve.
+	float flatteningError(const pa::QuadraticBSpline& splines, float scale, const pa::Polylines& lines) {
+		constexpr int samples = 32;
+		float worst = 0.0f;
+		for (size_t c = 0; c < splines.curveCount(); c++) {
+			size_t first = splines.firstSegment(c), last = splines.firstSegment(c + 1);
+			const pa::Point* points = &lines.points[0] + lines.offsets[c];
+			size_t count = lines.offsets[c + 1] - lines.offsets[c];
+			if (first == last) {
+				if (count != 0) return -1.0f;
+				continue;
+			}
+			pa::Point start = scale * splines(first, 0.0f), end = scale * splines(last - 1, 1.0f);
+			if (count < 2 || distanceToSegment(start, points[0], points[0]) > 1e-4f * scale
+				|| distanceToSegment(end, points[count - 1], points[count - 1]) > 1e-4f * scale)
+				return -1.0f;
+			for (size_t s = first; s < last; s++) {
+				for (int i = 0; i <= samples; i++) {
+					pa::Point p = scale * splines(s, static_cast<float>(i) / samples);
+					float best = distanceToSegment(p, points[0], points[1]);
+					for (size_t k = 1; k + 1 < count; k++)
+						best = std::min(best, distanceToSegment(p, points[k], points[k + 1]));
+					worst = std::max(worst, best);
+				}
+			}
+		}
+		return worst;
+	}
+}
+
+
+int main()
+{
+	using pa::test::check;
+	std::cout << "Starting regression tests on splines" << std::endl;
+
+	// control points of a smoothed diagram, above the 64x64 threshold of the graph
+	sf::Image image = pa::test::makeImage(96, 80, 21);
+	pa::PixelGraph graph{ pa::PixelGraphParam(image) };
+	graph.compute(1);
+	pa::VoronoiDiagram diagram;
+	diagram.setGraph(graph);
+	diagram.compute(1);
+	pa::CurveExtractor curves;
+	curves.setDiagram(diagram);
+	curves.compute();
+	pa::CurveSmoother smoother;
+	smoother.setCurves(curves);
+	smoother.compute(1);
+	check(!smoother.getControls().points.empty(), "control points found");
+	for (unsigned threads : { 3u, 0u }) {
+		pa::CurveSmoother parallel;
+		parallel.setCurves(curves);
+		parallel.compute(threads);
+		check(parallel.getControls().points == smoother.getControls().points
+			&& parallel.getControls().fixed == smoother.getControls().fixed,
+			"smoothing on " + std::to_string(threads) + " threads");
+	}
+
+	pa::QuadraticBSpline splines;
+	smoother.appendSplines(splines);
+	check(splines.curveCount() > 0, "splines found");
+	const std::vector<float> ts{ 0.0f, 0.25f, 0.6f, 1.0f };
+
+	// random control polygons, open and closed, more segments than an evaluation block
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> coordinate(0.0f, 20.0f);
+	std::vector<pa::Point> polygon;
+	float worst = 0.0f;
+	for (size_t n = 1; n < 40; n++) {
+		polygon.clear();
+		for (size_t i = 0; i < n; i++)
+			polygon.emplace_back(coordinate(rng), coordinate(rng));
+		bool closed = n % 3 == 0;
+		size_t first = splines.append(polygon.data(), polygon.size(), closed);
+		size_t segments = closed ? n : (n > 2 ? n - 2 : 0);
+		check(splines.size() - first == segments, std::to_string(n) + " control points : segments");
+		for (size_t s = 0; s < segments; s++) {
+			for (float t : ts) {
+				pa::Point d = splines(first + s, t) - quadratic(polygon[s], polygon[(s + 1) % n], polygon[(s + 2) % n], t);
+				worst = std::max(worst, std::sqrt(d.x * d.x + d.y * d.y));
+			}
+		}
+	}
+	check(worst < 1e-4f, "segments of the control points, error " + std::to_string(worst));
+
+	// batched evaluation, same floats as one segment at a time
+	std::vector<float> xs(ts.size() * splines.size()), ys(xs.size());
+	splines.evaluate(ts.data(), ts.size(), xs.data(), ys.data());
+	bool same = true;
+	for (size_t i = 0; i < ts.size(); i++) {
+		for (size_t s = 0; s < splines.size(); s++) {
+			pa::Point p = splines(s, ts[i]);
+			same &= p.x == xs[i * splines.size() + s] && p.y == ys[i * splines.size() + s];
+		}
+	}
+	check(same, "batched evaluation");
+
+	pa::Polylines lines;
+	for (float scale : { 1.0f, 8.0f, 32.0f }) {
+		for (float tolerance : { 0.25f, 0.05f }) {
+			splines.flatten(scale, tolerance, lines);
+			std::string what = "flattening at scale " + std::to_string(scale) + " within " + std::to_string(tolerance);
+			check(lines.size() == splines.curveCount(), what + " : one polyline per curve");
+			float error = flatteningError(splines, scale, lines);
+			check(error >= 0.0f, what + " : polyline ends");
+			// up to float rounding of the scaled points
+			check(error <= tolerance + 1e-5f * scale, what + " : error " + std::to_string(error));
+		}
+	}
+
+	return pa::test::report("spline");
+}
@@ -147,7 +147,7 @@ int main(int argc, char* argv[])
             for (int i = 0; i < dim.x; i++) {
                 for (int j = 0; j < dim.y; j++) {
                     for (int k = 0; k < pa::NUM_DIR; k++) {
-                        if (graph_edges[i][j][k]) {
+                        if (graph_edges(i, j) & (1 << k)) {
                             auto dir = pa::VecDir[k];
                             line[0].position = scale * sf::Vector2f(i + 0.5f, j + 0.5f);
                             line[1].position = scale * sf::Vector2f(i + 0.5f + dir.x, j + 0.5f + dir.y);
@@ -160,27 +160,22 @@ int main(int argc, char* argv[])
         }
         case Mode::DISPLAY_VORONOI :
         {
-            const pa::diagram& d = diagram.getDiagram();
-            for (auto& vec : d) {
-                for (auto& p : vec.second) {
-                    line[0].position = scale * vec.first;
-                    line[1].position = scale * p;
-                    window.draw(line, 2, sf::Lines);
-                }
+            const pa::VoronoiMesh& d = diagram.getDiagram();
+            for (uint32_t e = 0; e < d.halfEdgeCount(); e++) {
+                line[0].position = scale * pa::to_point(d.vertices[d.origin[e]]);
+                line[1].position = scale * pa::to_point(d.vertices[d.target(e)]);
+                window.draw(line, 2, sf::Lines);
             }
             break;
         }
         case Mode::DISPLAY_ACTIVE_EDGES :
         {
             const pa::edge_list& active_edges = diagram.getActiveEdges();
-            for (auto& edge_color : active_edges) {
-                auto& edge = edge_color.first;
-                /*if (&(*active_edges.find(pa::Edge(edge.p2, edge.p1))) != &edge_color) {
-                    std::cout << "Problem on edges hash table" <<std::endl;
-                }*/
-                auto& colors = edge_color.second.colors;
-                line[0].position = scale * edge.p1;
-                line[1].position = scale * edge.p2;
+            for (auto& active : active_edges) {
+                pa::Edge edge = active.edge();
+                auto& colors = active.colors;
+                line[0].position = scale * pa::to_point(edge.p1);
+                line[1].position = scale * pa::to_point(edge.p2);
                 line[0].color = colors[disp_color];
                 line[1].color = colors[disp_color];
 
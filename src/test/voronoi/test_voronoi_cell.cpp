@@ -125,10 +125,11 @@ int main(int argc, char* argv[])
             }
         }*/
         auto& cell = cells[type];
-        for (int i = 0; i < cell.size(); i++) {
-            int j = (i + 1) % cell.size();
-            line[0].position = scale * cell[i];
-            line[1].position = scale * cell[j];
+        for (int i = 0; i < cell.size; i++) {
+            int j = (i + 1) % cell.size;
+            // centered on the pixel, in pixels
+            line[0].position = scale * 0.25f * sf::Vector2f(cell.points[i].x - 2, cell.points[i].y - 2);
+            line[1].position = scale * 0.25f * sf::Vector2f(cell.points[j].x - 2, cell.points[j].y - 2);
             window.draw(line, 2, sf::Lines);
         }
 
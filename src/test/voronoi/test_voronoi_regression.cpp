@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <PixelArt/voronoi_diagram.h>
+#include "../regression.h"
+
+// Regression tests of the Voronoi diagram, without window : the half-edge mesh must be
+// consistent, and the same whatever the threads and the color tests of the graph.
+
+namespace {
+	bool sameMesh(const pa::VoronoiMesh& a, const pa::VoronoiMesh& b) {
+		return a.vertices == b.vertices && a.face_offsets == b.face_offsets && a.origin == b.origin
+			&& a.face == b.face && a.twin == b.twin && a.height == b.height;
+	}
+
+	bool sameActiveEdges(const pa::edge_list& a, const pa::edge_list& b) {
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); i++) {
+			if (a[i].id != b[i].id || a[i].half_edge != b[i].half_edge || a[i].v != b[i].v
+				|| a[i].colors != b[i].colors)
+				return false;
+		}
+		return true;
+	}
+
+	// every active edge is found by its id
+	bool indexConsistent(const pa::edge_list& edges) {
+		for (const pa::ActiveEdge& e : edges)
+			if (edges.find(e.id) != &e)
+				return false;
+		return true;
+	}
+
+	bool sameRegions(const pa::RegionPolygons& a, const pa::RegionPolygons& b) {
+		return a.face_region == b.face_region && a.colors == b.colors && a.region_offsets == b.region_offsets
+			&& a.loop_offsets == b.loop_offsets && a.vertices == b.vertices;
+	}
+
+	// twice the signed area of a polygon of mesh vertices
+	template<class Index>
+	int64_t twiceArea(const pa::VoronoiMesh& mesh, Index index, uint32_t first, uint32_t last) {
+		int64_t area = 0;
+		for (uint32_t i = first; i < last; i++) {
+			pa::LatticePoint p = mesh.vertices[index(i)];
+			pa::LatticePoint q = mesh.vertices[index(i + 1 < last ? i + 1 : first)];
+			area += static_cast<int64_t>(pa::lattice_x(p)) * pa::lattice_y(q)
+				- static_cast<int64_t>(pa::lattice_x(q)) * pa::lattice_y(p);
+		}
+		return area;
+	}
+
+	// Every pixel is in a region, and the loops of a region, holes counting negatively,
+	// enclose the area of its cells
+	bool regionAreas(const pa::RegionPolygons& regions, const pa::VoronoiMesh& mesh) {
+		if (regions.face_region.size() != mesh.faceCount())
+			return false;
+		std::vector<int64_t> cells(regions.regionCount(), 0);
+		for (uint32_t f = 0; f < mesh.faceCount(); f++) {
+			uint32_t r = regions.face_region[f];
+			if (r >= regions.regionCount())
+				return false;
+			cells[r] += twiceArea(mesh, [&mesh](uint32_t e) { return mesh.origin[e]; },
+				mesh.face_offsets[f], mesh.face_offsets[f + 1]);
+		}
+		for (size_t r = 0; r < regions.regionCount(); r++) {
+			int64_t area = 0;
+			for (uint32_t l = regions.region_offsets[r]; l < regions.region_offsets[r + 1]; l++)
+				area += twiceArea(mesh, [&regions](uint32_t i) { return regions.vertices[i]; },
+					regions.loop_offsets[l], regions.loop_offsets[l + 1]);
+			if (area != cells[r])
+				return false;
+		}
+		return true;
+	}
+
+	// Twins are mutual, reversed, and in another face. Only edges starting or ending on
+	// the image border have none : a border point between two cells is removed as valence
+	// 2, joining a border edge and the edge the cells share.
+	bool twinsConsistent(const pa::VoronoiMesh& mesh, const sf::Vector2u& dim) {
+		const int right = 4 * static_cast<int>(dim.x), bottom = 4 * static_cast<int>(dim.y);
+		auto onBorder = [right, bottom](pa::LatticePoint p) {
+			return pa::lattice_x(p) == 0 || pa::lattice_y(p) == 0 || pa::lattice_x(p) == right || pa::lattice_y(p) == bottom;
+		};
+		for (uint32_t e = 0; e < mesh.halfEdgeCount(); e++) {
+			uint32_t t = mesh.twin[e];
+			if (t == pa::VoronoiMesh::none) {
+				if (!onBorder(mesh.vertices[mesh.origin[e]]) && !onBorder(mesh.vertices[mesh.target(e)]))
+					return false;
+				continue;
+			}
+			if (mesh.twin[t] != e || mesh.origin[t] != mesh.target(e) || mesh.target(t) != mesh.origin[e]
+				|| mesh.face[t] == mesh.face[e])
+				return false;
+		}
+		return true;
+	}
+}
+
+
+int main()
+{
+	using pa::test::check;
+	std::cout << "Starting regression tests on voronoi diagram" << std::endl;
+
+	const std::vector<sf::Vector2u> sizes{ { 96, 80 }, { 130, 67 }, { 21, 13 }, { 1, 9 } };
+	for (size_t i = 0; i < sizes.size(); i++) {
+		sf::Image image = pa::test::makeImage(sizes[i].x, sizes[i].y, static_cast<unsigned>(i + 11));
+		std::string name = std::to_string(sizes[i].x) + "x" + std::to_string(sizes[i].y);
+
+		pa::PixelGraph graph{ pa::PixelGraphParam(image) };
+		graph.compute(1);
+		pa::VoronoiDiagram serial;
+		serial.setGraph(graph);
+		serial.compute(1);
+		const pa::VoronoiMesh& mesh = serial.getDiagram();
+		check(mesh.faceCount() == static_cast<size_t>(sizes[i].x) * sizes[i].y, name + " : one face per pixel");
+		check(twinsConsistent(mesh, sizes[i]), name + " : twin symmetry");
+		check(serial.getActiveEdges().size() > 0 || sizes[i].x == 1, name + " : active edges found");
+		check(indexConsistent(serial.getActiveEdges()), name + " : active edges index");
+		check(regionAreas(serial.getRegions(), mesh), name + " : region areas");
+
+		for (unsigned threads : { 2u, 3u, 0u }) {
+			pa::VoronoiDiagram parallel;
+			parallel.setGraph(graph);
+			parallel.compute(threads);
+			std::string what = name + " on " + std::to_string(threads) + " threads";
+			check(sameMesh(mesh, parallel.getDiagram()), what + " : mesh");
+			check(sameActiveEdges(serial.getActiveEdges(), parallel.getActiveEdges()), what + " : active edges");
+			check(sameRegions(serial.getRegions(), parallel.getRegions()), what + " : regions");
+		}
+
+		// palette mode uses lookup tables for both graph and visibility tests
+		pa::PixelGraph palette_graph{ pa::PixelGraphParam(image, pa::ColorYUV(42.0f, 7.0f, 6.0f), true) };
+		palette_graph.compute(3);
+		pa::VoronoiDiagram palette;
+		palette.setGraph(palette_graph);
+		palette.compute(3);
+		check(sameMesh(mesh, palette.getDiagram()), name + " palette mode : mesh");
+		check(sameActiveEdges(serial.getActiveEdges(), palette.getActiveEdges()), name + " palette mode : active edges");
+	}
+
+	return pa::test::report("voronoi diagram");
+}
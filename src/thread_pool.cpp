@@ -0,0 +1,85 @@
+#include <PixelArt/thread_pool.h>
+#include <algorithm>
+
+namespace pa {
+
+	ThreadPool::ThreadPool(unsigned threads) :
+		m_job(nullptr),
+		m_count(0),
+		m_next(0),
+		m_busy(0),
+		m_generation(0),
+		m_stop(false)
+	{
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned i = 1; i < threads; i++)
+			m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_start.notify_all();
+		for (auto& t : m_workers)
+			t.join();
+	}
+
+	void ThreadPool::work()
+	{
+		size_t i;
+		while ((i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count)
+			(*m_job)(i);
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		size_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+				if (m_stop)
+					return;
+				seen = m_generation;
+			}
+			work();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (--m_busy == 0)
+					m_done.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& f)
+	{
+		if (count == 0)
+			return;
+		// not worth waking anyone
+		if (m_workers.empty() || count == 1) {
+			for (size_t i = 0; i < count; i++)
+				f(i);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &f;
+			m_count = count;
+			m_next.store(0, std::memory_order_relaxed);
+			m_busy = m_workers.size();
+			m_generation++;
+		}
+		m_start.notify_all();
+
+		work();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_busy == 0; });
+		m_job = nullptr;
+	}
+}
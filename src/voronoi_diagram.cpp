@@ -2,6 +2,7 @@
 #include <iostream>
 #include <utility>
 #include <numeric>
+#include <algorithm>
 
 namespace pa {
 
@@ -32,72 +33,153 @@ namespace pa {
 	}
 
 
-	voronoiCell CellsCalculation::generateCellByType(voronoiCellType type) {
-		voronoiCell cell;
+	namespace {
+		// Valence of the points a corner gives, from the two diagonals of its
+		// square and the image borders next to it
+		constexpr int cornerValence(voronoiCellType type, int own, int other, uint8_t border, uint8_t sides) {
+			if (type & 1 << own) return (type & 1 << other) ? 2 : 3;
+			if (type & 1 << other) return 3;
+			// plain corner, shared by the pixels around it
+			uint8_t missing = border & sides;
+			return !missing ? 4 : (missing == sides ? 1 : 2);
+		}
 
-		#define CUSTOM_PARCOURS_EDGE(i) (type & 1<<i)
+		constexpr int midValence(uint8_t border, uint8_t side) {
+			return (border & side) ? 1 : 2;
+		}
 
-		//TOPLEFT
-		if (CUSTOM_PARCOURS_EDGE(0))
-		{
-			cell.emplace_back(-0.25, -0.75); // 1
-			cell.emplace_back(-0.75, -0.25); // 2
+		// Points are in quarter pixels from the pixel's center. When simplified,
+		// valence 2 points are not added, apart from the first one.
+		constexpr void addPoint(LatticeCell& cell, int x, int y, int valence, bool simplified) {
+			if (!simplified || !cell.size || valence != 2)
+				cell.push(2 + x, 2 + y);
 		}
-		else if (CUSTOM_PARCOURS_EDGE(1))
-			cell.emplace_back(-0.25, -0.25); // 3
-		else cell.emplace_back(-0.5, -0.5); // 4
-
-		//LEFT
-		cell.emplace_back(-0.5, 0.0); // Mid-point
-
-		//BOTTOMLEFT
-		if (CUSTOM_PARCOURS_EDGE(7))
-		{
-			cell.emplace_back(-0.75, +0.25); // 1
-			cell.emplace_back(-0.25, +0.75); // 2
+
+		constexpr LatticeCell generateCell(voronoiCellType type, uint8_t border, bool simplified) {
+			LatticeCell cell{};
+
+			#define CUSTOM_PARCOURS_EDGE(i) (type & 1<<i)
+
+			//TOPLEFT
+			int v = cornerValence(type, 0, 1, border, BORDER_LEFT | BORDER_TOP);
+			if (CUSTOM_PARCOURS_EDGE(0))
+			{
+				addPoint(cell, -1, -3, v, simplified); // 1
+				addPoint(cell, -3, -1, v, simplified); // 2
+			}
+			else if (CUSTOM_PARCOURS_EDGE(1))
+				addPoint(cell, -1, -1, v, simplified); // 3
+			else addPoint(cell, -2, -2, v, simplified); // 4
+
+			//LEFT
+			addPoint(cell, -2, 0, midValence(border, BORDER_LEFT), simplified); // Mid-point
+
+			//BOTTOMLEFT
+			v = cornerValence(type, 7, 6, border, BORDER_LEFT | BORDER_BOTTOM);
+			if (CUSTOM_PARCOURS_EDGE(7))
+			{
+				addPoint(cell, -3, +1, v, simplified); // 1
+				addPoint(cell, -1, +3, v, simplified); // 2
+			}
+			else if (CUSTOM_PARCOURS_EDGE(6))
+				addPoint(cell, -1, +1, v, simplified); // 3
+			else addPoint(cell, -2, +2, v, simplified); // 4
+
+			//BOTTOM
+			addPoint(cell, 0, +2, midValence(border, BORDER_BOTTOM), simplified); // Mid-point
+
+			//BOTTOMRIGHT
+			v = cornerValence(type, 4, 5, border, BORDER_RIGHT | BORDER_BOTTOM);
+			if (CUSTOM_PARCOURS_EDGE(4))
+			{
+				addPoint(cell, +1, +3, v, simplified); // 1
+				addPoint(cell, +3, +1, v, simplified); // 2
+			}
+			else if (CUSTOM_PARCOURS_EDGE(5))
+				addPoint(cell, +1, +1, v, simplified); // 3
+			else addPoint(cell, +2, +2, v, simplified); // 4
+
+			//RIGHT
+			addPoint(cell, +2, 0, midValence(border, BORDER_RIGHT), simplified); // Mid-point
+
+			//TOPRIGHT
+			v = cornerValence(type, 3, 2, border, BORDER_RIGHT | BORDER_TOP);
+			if (CUSTOM_PARCOURS_EDGE(3))
+			{
+				addPoint(cell, +3, -1, v, simplified); // 1
+				addPoint(cell, +1, -3, v, simplified); // 2
+			}
+			else if (CUSTOM_PARCOURS_EDGE(2))
+				addPoint(cell, +1, -1, v, simplified); // 3
+			else addPoint(cell, +2, -2, v, simplified); // 4
+
+			//TOP
+			addPoint(cell, 0, -2, midValence(border, BORDER_TOP), simplified); // Mid-point
+
+			#undef CUSTOM_PARCOURS_EDGE
+
+			return cell;
 		}
-		else if (CUSTOM_PARCOURS_EDGE(6))
-			cell.emplace_back(-0.25, +0.25); // 3
-		else cell.emplace_back(-0.5, +0.5); // 4
-
-		//BOTTOM
-		cell.emplace_back(0.0, +0.5); // Mid-point
-
-		//BOTTOMRIGHT
-		if (CUSTOM_PARCOURS_EDGE(4))
-		{
-			cell.emplace_back(+0.25, +0.75); // 1
-			cell.emplace_back(+0.75, +0.25); // 2
+
+		template<size_t N>
+		constexpr std::array<LatticeCell, N> generateAllCells(bool simplified) {
+			std::array<LatticeCell, N> cells{};
+			for (size_t key = 0; key < N; key++)
+				cells[key] = generateCell(voronoiCellType(key & 0xFF), uint8_t(key >> 8), simplified);
+			return cells;
 		}
-		else if (CUSTOM_PARCOURS_EDGE(5))
-			cell.emplace_back(+0.25, +0.25); // 3
-		else cell.emplace_back(+0.5, +0.5); // 4
-
-		//RIGHT
-		cell.emplace_back(+0.5, 0.0); // Mid-point
-
-		//TOPRIGHT
-		if (CUSTOM_PARCOURS_EDGE(3))
-		{
-			cell.emplace_back(+0.75, -0.25); // 1
-			cell.emplace_back(+0.25, -0.75); // 2
+
+		// Accurate cells, by type
+		constexpr possible_cells_list possibleCells = generateAllCells<TOTAL_VORONOI_CELLS>(false);
+
+		// Cells with their valence 2 points removed, by simplifiedCellKey. Only the
+		// cells of the 3x3 neighbourhood can share a point with a cell, and the
+		// points they share only depend on the diagonals the cell type holds and
+		// on the image borders, so the reduction over the whole diagram is local.
+		constexpr simplified_cells_list simplifiedCells = generateAllCells<TOTAL_SIMPLIFIED_CELLS>(true);
+	}
+
+	const ActiveEdge* ActiveEdgeList::find(EdgeId id) const {
+		if (m_index.empty()) return nullptr;
+		for (size_t i = slot(id); m_index[i] != none; i = (i + 1) & (m_index.size() - 1)) {
+			if (m_edges[m_index[i]].id == id) return &m_edges[m_index[i]];
 		}
-		else if (CUSTOM_PARCOURS_EDGE(2))
-			cell.emplace_back(+0.25, -0.25); // 3
-		else cell.emplace_back(+0.5, -0.5); // 4
+		return nullptr;
+	}
+
+	void ActiveEdgeList::assign(std::vector<ActiveEdge>&& edges) {
+		m_edges = std::move(edges);
+		// at most half full
+		size_t capacity = 1;
+		while (capacity < 2 * m_edges.size()) capacity <<= 1;
+		m_index.assign(capacity, none);
+		for (uint32_t e = 0; e < m_edges.size(); e++) {
+			size_t i = slot(m_edges[e].id);
+			while (m_index[i] != none) i = (i + 1) & (capacity - 1);
+			m_index[i] = e;
+		}
+	}
 
-		//TOP
-		cell.emplace_back(0.0, -0.5); // Mid-point
+	void ActiveEdgeList::clear() {
+		m_edges.clear();
+		m_index.clear();
+	}
 
-		return cell;
+	void VoronoiMesh::clear() {
+		vertices.clear();
+		face_offsets.clear();
+		origin.clear();
+		face.clear();
+		twin.clear();
 	}
 
-	void CellsCalculation::generateAllCellTypes() {
-		std::generate(possibleCells.begin(), possibleCells.end(),
-			[this, i = 0]() mutable{return generateCellByType(i++); });
+	void RegionPolygons::clear() {
+		face_region.clear();
+		colors.clear();
+		region_offsets.clear();
+		loop_offsets.clear();
+		vertices.clear();
 	}
-	// declare
-	CellsCalculation VoronoiDiagram::cellsCalculation;
 
 
 
@@ -106,21 +188,10 @@ namespace pa {
 		m_graph(nullptr),
 		m_test_visibility(p)
 	{
-		// instantiate calculations
-		(void)cellsCalculation;
-	
 	}
 
 	void VoronoiDiagram::setGraph(const PixelGraph& graph) {
 		m_graph = &graph;
-		m_voronoiPoints.clear();
-		sf::Vector2u dim = graph.getImage().getSize();
-
-		for (int i = 0; i < dim.x; i++)
-		{
-			std::vector<voronoiCell> v2(0);
-			m_voronoiPoints.push_back(v2);
-		}
 	}
 
 	// Give new set of parameter for active edge determination
@@ -129,128 +200,329 @@ namespace pa {
 	}
 
 
-	voronoiCellType VoronoiDiagram::extractType(const IntPoint& p) const {
-		// warning : for_each takes a copy of the functor... so better with lambda function and reference
-		voronoiCellType result = 0;
-		std::for_each(node_parcours.begin(), node_parcours.end(), [this, &p, &result, edges_seen = 0](Direction& dir) mutable
-		{
-			if (m_graph->edge(p + VecDir[dir], edges_parcours[edges_seen % 2]))
-				result |= (1 << edges_seen);
-			edges_seen++;
-		});
-		return result;
+	namespace {
+		// Borders of the image pixel (x,y) lies on
+		uint8_t cellBorder(int x, int y, int width, int height) {
+			return static_cast<uint8_t>((x == 0 ? BORDER_LEFT : 0) | (y == 0 ? BORDER_TOP : 0)
+				| (x == width - 1 ? BORDER_RIGHT : 0) | (y == height - 1 ? BORDER_BOTTOM : 0));
+		}
 	}
 
-	void VoronoiDiagram::generateAccurateDiagram() {
+	void VoronoiDiagram::countCellPoints(int x0, int x1) {
 		sf::Vector2u dim = m_graph->getImage().getSize();
+		const int width = static_cast<int>(dim.x);
+		const int height = static_cast<int>(dim.y);
+		const std::vector<uint8_t>& types = m_graph->getCellTypes();
+
+		for (int x = x0; x < x1; x++) {
+			for (int y = 0; y < height; y++) {
+				size_t f = static_cast<size_t>(x * height + y);
+				uint8_t border = cellBorder(x, y, width, height);
+				m_mesh.face_offsets[f + 1] = simplifiedCells[simplifiedCellKey(types[f], border)].size;
+			}
+		}
+	}
 
-		for (int x = 0; x < dim.x; x++) {
-			for (int y = 0; y < dim.y; y++) {
-				sf::Color color = m_graph->getImage().getPixel(x, y);
-				voronoiCellType type = extractType(IntPoint(x, y));
-				voronoiCell cell = cellsCalculation.possibleCells[type];
-				// move and add point
-				for (auto& p :cell) p += Point(x + 0.5, y + 0.5);
-				m_voronoiPoints[x].push_back(cell);
-
-				// Populate hash table 
-				for (auto& p : m_voronoiPoints[x][y]) {
-					if (m_valency.find(p) == m_valency.end())
-						m_valency[p] = 1;
-					else
-						m_valency[p]++;
-				}
+	void VoronoiDiagram::expandCells(int x0, int x1) {
+		sf::Vector2u dim = m_graph->getImage().getSize();
+		const int width = static_cast<int>(dim.x);
+		const int height = static_cast<int>(dim.y);
+		const std::vector<uint8_t>& types = m_graph->getCellTypes();
+
+		for (int x = x0; x < x1; x++) {
+			for (int y = 0; y < height; y++) {
+				uint32_t f = static_cast<uint32_t>(x * height + y);
+				uint8_t border = cellBorder(x, y, width, height);
+				// move points of the simplified cell
+				uint32_t first = m_mesh.face_offsets[f];
+				int size = expandCell(simplifiedCells[simplifiedCellKey(types[f], border)],
+					x, y, &m_points[first]);
+				std::fill_n(&m_mesh.face[first], size, f);
+			}
+		}
+	}
 
+	void VoronoiDiagram::findFirstEdges(int x0, int x1) {
+		const int height = static_cast<int>(m_mesh.height);
+		// neighbours numbered before a face, in face order
+		const std::array<IntPoint, 4> before{ IntPoint(-1, -1), IntPoint(-1, 0), IntPoint(-1, 1), IntPoint(0, -1) };
+
+		for (int x = x0; x < x1; x++) {
+			for (int y = 0; y < height; y++) {
+				uint32_t f = static_cast<uint32_t>(x * height + y);
+				for (uint32_t e = m_mesh.face_offsets[f]; e < m_mesh.face_offsets[f + 1]; e++) {
+					uint32_t first = e;
+					for (const IntPoint& d : before) {
+						IntPoint n(x + d.x, y + d.y);
+						if (n.x < 0 || n.y < 0 || n.y >= height) continue;
+						uint32_t g = static_cast<uint32_t>(n.x * height + n.y);
+						const LatticePoint* begin = &m_points[m_mesh.face_offsets[g]];
+						const LatticePoint* end = begin + (m_mesh.face_offsets[g + 1] - m_mesh.face_offsets[g]);
+						const LatticePoint* found = std::find(begin, end, m_points[e]);
+						if (found != end) {
+							first = m_mesh.face_offsets[g] + static_cast<uint32_t>(found - begin);
+							break;
+						}
+					}
+					m_first_edge[e] = first;
+				}
 			}
 		}
 	}
 
-	void VoronoiDiagram::checkAndAddActiveEdge(Point& pa, Point& pb, int x, int y) {
-		auto& color = m_graph->getImage().getPixel(x, y);
-		auto e = Edge(pa, pb);
-		auto& it = m_active_edges.find(e);
-		if (it == m_active_edges.end()) {
-			// add the edge
-			m_active_edges[e].colors = { color };
+	uint32_t VoronoiDiagram::countVertices(int x0, int x1) const {
+		uint32_t count = 0;
+		uint32_t end = columnStart(x1);
+		for (uint32_t e = columnStart(x0); e < end; e++) {
+			count += m_first_edge[e] == e;
 		}
-		else {
-			// If one color has already been added, check for dissimilarity
-			// and determine visibility
-			auto v = m_test_visibility((*it).second.colors[0], color);
-			if (v != None)
-				m_active_edges[e].colors.push_back(color);
+		return count;
+	}
+
+	void VoronoiDiagram::numberVertices(int x0, int x1, uint32_t id) {
+		uint32_t end = columnStart(x1);
+		for (uint32_t e = columnStart(x0); e < end; e++) {
+			if (m_first_edge[e] == e) {
+				m_mesh.origin[e] = id;
+				m_mesh.vertices[id++] = m_points[e];
+			}
 		}
 	}
 
-	void VoronoiDiagram::simplifyDiagram() {
-		sf::Vector2u dim = m_graph->getImage().getSize();
+	void VoronoiDiagram::setOrigins(int x0, int x1) {
+		uint32_t end = columnStart(x1);
+		for (uint32_t e = columnStart(x0); e < end; e++) {
+			uint32_t first = m_first_edge[e];
+			if (first != e) m_mesh.origin[e] = m_mesh.origin[first];
+		}
+	}
 
+	void VoronoiDiagram::listOutEdges(int x0, int x1) {
+		uint32_t end = columnStart(x1);
+		for (uint32_t e = columnStart(x0); e < end; e++) {
+			for (auto& out : m_out_edges[m_mesh.origin[e]]) {
+				if (out == VoronoiMesh::none) {
+					out = e;
+					break;
+				}
+			}
+		}
+	}
 
-		for (int x = 0; x < dim.x; x++) {
-			for (int y = 0; y < dim.y; y++) {
-				// create diagram, not adding valence 2 points
-				int a = 0;
-				int b = 1;
-				int size = m_voronoiPoints[x][y].size();
-				if (!size) continue;
-				do {
-					auto& pa = m_voronoiPoints[x][y][a];
-					auto& pb = m_voronoiPoints[x][y][b];
-					if (m_valency[pb] != 2 ) {
-						m_diagram[pa].push_back(pb);
-						checkAndAddActiveEdge(pa, pb, x, y);
-
-						a = b;
-						b = (b + 1) % size;
-					}
-					else {
-						m_active_edges.erase(Edge(pa, pb));
-						b = (b + 1) % size;
-					}
-				} while (b != 0);
-				auto& pa = m_voronoiPoints[x][y][a];
-				auto& pb = m_voronoiPoints[x][y][b];
-				m_diagram[pa].push_back(pb);
-				checkAndAddActiveEdge(pa, pb, x, y);
+	void VoronoiDiagram::linkTwins(int x0, int x1) {
+		uint32_t end = columnStart(x1);
+		for (uint32_t e = columnStart(x0); e < end; e++) {
+			uint32_t a = m_mesh.origin[e];
+			uint32_t b = m_mesh.target(e);
+			for (uint32_t out : m_out_edges[b]) {
+				if (out == VoronoiMesh::none) break;
+				if (m_mesh.target(out) == a) {
+					m_mesh.twin[e] = out;
+					break;
+				}
 			}
 		}
 	}
 
-	void VoronoiDiagram::deleteNonActiveEdges() {
-		// delete non active edges
-		auto& iter = m_active_edges.begin();
-		while (iter != m_active_edges.end()) {
-			if ((*iter).second.colors.size() != 2) {
-				iter = m_active_edges.erase(iter);
+	void VoronoiDiagram::findActiveEdges(int x0, int x1, std::vector<ActiveEdge>& found) const {
+		const sf::Image& image = m_graph->getImage();
+		const Palette& palette = m_graph->getPalette();
+		uint32_t end = columnStart(x1);
+		for (uint32_t e = columnStart(x0); e < end; e++) {
+			// each shared edge once, from its first face
+			uint32_t t = m_mesh.twin[e];
+			if (t == VoronoiMesh::none || t < e) continue;
+			IntPoint p1 = m_mesh.pixel(m_mesh.face[e]);
+			IntPoint p2 = m_mesh.pixel(m_mesh.face[t]);
+			ActiveEdge edge;
+			edge.colors = { image.getPixel(static_cast<unsigned>(p1.x), static_cast<unsigned>(p1.y)),
+				image.getPixel(static_cast<unsigned>(p2.x), static_cast<unsigned>(p2.y)) };
+			// check for dissimilarity and determine visibility
+			edge.v = palette.empty() ? uint8_t(m_test_visibility(edge.colors[0], edge.colors[1]))
+				: m_visibility_table(palette(p1.x, p1.y), palette(p2.x, p2.y));
+			if (edge.v != None) {
+				edge.id = Edge(m_mesh.vertices[m_mesh.origin[e]], m_mesh.vertices[m_mesh.origin[t]]).id();
+				edge.half_edge = e;
+				found.push_back(edge);
 			}
-			else {
-				iter++;
+		}
+	}
 
+	void VoronoiDiagram::labelRegions() {
+		const pixel_graph_edges& graph = m_graph->getGraph();
+		const sf::Image& image = m_graph->getImage();
+		const int height = static_cast<int>(m_mesh.height);
+		std::vector<uint32_t>& region = m_regions.face_region;
+		region.assign(m_mesh.faceCount(), VoronoiMesh::none);
+
+		// flood fill from the first pixel of each region
+		std::vector<uint32_t> stack;
+		for (uint32_t f = 0; f < region.size(); f++) {
+			if (region[f] != VoronoiMesh::none) continue;
+			uint32_t r = static_cast<uint32_t>(m_regions.colors.size());
+			IntPoint p = m_mesh.pixel(f);
+			m_regions.colors.push_back(image.getPixel(static_cast<unsigned>(p.x), static_cast<unsigned>(p.y)));
+			region[f] = r;
+			stack.push_back(f);
+			while (!stack.empty()) {
+				uint32_t g = stack.back();
+				stack.pop_back();
+				IntPoint q = m_mesh.pixel(g);
+				neighbour_mask mask = graph(q.x, q.y);
+				for (size_t k = 0; k < NUM_DIR; k++) {
+					if (!(mask & 1 << k)) continue;
+					uint32_t n = static_cast<uint32_t>(static_cast<int>(g) + VecDir[k].x * height + VecDir[k].y);
+					if (region[n] == VoronoiMesh::none) {
+						region[n] = r;
+						stack.push_back(n);
+					}
+				}
 			}
 		}
 	}
 
+	bool VoronoiDiagram::isRegionBoundary(uint32_t e) const {
+		uint32_t t = m_mesh.twin[e];
+		return t == VoronoiMesh::none
+			|| m_regions.face_region[m_mesh.face[t]] != m_regions.face_region[m_mesh.face[e]];
+	}
+
+	uint32_t VoronoiDiagram::nextRegionBoundary(uint32_t e) const {
+		uint32_t n = m_mesh.next(e);
+		while (!isRegionBoundary(n)) n = m_mesh.next(m_mesh.twin[n]);
+		return n;
+	}
+
+	void VoronoiDiagram::traceRegions() {
+		// Loops found in half-edge order, then sorted by region. The first boundary half-edge
+		// of a region is in its first pixel, left of any other pixel of the region.
+		struct Loop {
+			uint32_t start;
+			uint32_t size;
+		};
+		std::vector<Loop> loops;
+		std::vector<uint8_t> visited(m_mesh.halfEdgeCount(), 0);
+		std::vector<uint32_t>& offsets = m_regions.region_offsets;
+		offsets.assign(m_regions.regionCount() + 1, 0);
+		for (uint32_t e = 0; e < m_mesh.halfEdgeCount(); e++) {
+			if (visited[e] || !isRegionBoundary(e)) continue;
+			Loop loop{ e, 0 };
+			uint32_t b = e;
+			do {
+				visited[b] = 1;
+				loop.size++;
+				b = nextRegionBoundary(b);
+			} while (b != e);
+			loops.push_back(loop);
+			offsets[m_regions.face_region[m_mesh.face[e]] + 1]++;
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		std::vector<uint32_t> order(loops.size());
+		std::vector<uint32_t> slot(offsets.begin(), offsets.end() - 1);
+		for (uint32_t l = 0; l < loops.size(); l++)
+			order[slot[m_regions.face_region[m_mesh.face[loops[l].start]]]++] = l;
+
+		m_regions.loop_offsets.assign(loops.size() + 1, 0);
+		for (size_t i = 0; i < order.size(); i++)
+			m_regions.loop_offsets[i + 1] = m_regions.loop_offsets[i] + loops[order[i]].size;
+		m_regions.vertices.resize(m_regions.loop_offsets.back());
+		for (size_t i = 0; i < order.size(); i++) {
+			uint32_t* out = &m_regions.vertices[m_regions.loop_offsets[i]];
+			uint32_t e = loops[order[i]].start;
+			uint32_t b = e;
+			do {
+				*out++ = m_mesh.origin[b];
+				b = nextRegionBoundary(b);
+			} while (b != e);
+		}
+	}
+
 
-	void VoronoiDiagram::compute()
+	void VoronoiDiagram::compute(unsigned threads)
 	{
-		m_valency.clear();
-		m_diagram.clear();
+		const Palette& palette = m_graph->getPalette();
+		if (!palette.empty()) {
+			m_visibility_table.build(palette.colors.size(), [this, &palette](size_t i, size_t j) {
+				return m_test_visibility(palette.colors[i], palette.colors[j]);
+			});
+		}
+		sf::Vector2u dim = m_graph->getImage().getSize();
+		m_mesh.clear();
+		m_mesh.height = dim.y;
 		m_active_edges.clear();
-		generateAccurateDiagram();
-		simplifyDiagram();
-		deleteNonActiveEdges();
+		m_regions.clear();
+
+		// Split in strips of columns. Strips of same parity never share a point,
+		// stages writing to points run on even strips then on odd ones.
+		ThreadPool pool(threads);
+		size_t strips = pool.size() == 1 ? 1 : std::max<size_t>(1, std::min<size_t>(dim.x, 4 * pool.size()));
+		std::vector<int> bounds(strips + 1);
+		for (size_t s = 0; s <= strips; s++) bounds[s] = static_cast<int>(s * dim.x / strips);
+		auto each_strip = [&pool, &bounds, strips](const std::function<void(size_t, int, int)>& f) {
+			pool.parallel_for(strips, [&f, &bounds](size_t s) { f(s, bounds[s], bounds[s + 1]); });
+		};
+		auto alternate_strips = [&pool, &bounds, strips](const std::function<void(int, int)>& f) {
+			for (size_t parity = 0; parity < 2; parity++) {
+				pool.parallel_for((strips + 1 - parity) / 2, [&f, &bounds, parity](size_t i) {
+					f(bounds[2 * i + parity], bounds[2 * i + parity + 1]);
+				});
+			}
+		};
+
+		m_mesh.face_offsets.assign(size_t(dim.x) * dim.y + 1, 0);
+		each_strip([this](size_t, int x0, int x1) { countCellPoints(x0, x1); });
+		std::partial_sum(m_mesh.face_offsets.begin(), m_mesh.face_offsets.end(), m_mesh.face_offsets.begin());
+
+		size_t half_edges = m_mesh.face_offsets.back();
+		m_points.resize(half_edges);
+		m_mesh.face.resize(half_edges);
+		m_mesh.origin.resize(half_edges);
+		each_strip([this](size_t, int x0, int x1) { expandCells(x0, x1); });
+
+		// vertices numbered in order of first appearance
+		m_first_edge.resize(half_edges);
+		each_strip([this](size_t, int x0, int x1) { findFirstEdges(x0, x1); });
+		std::vector<uint32_t> first_id(strips + 1, 0);
+		each_strip([this, &first_id](size_t s, int x0, int x1) { first_id[s + 1] = countVertices(x0, x1); });
+		std::partial_sum(first_id.begin(), first_id.end(), first_id.begin());
+		m_mesh.vertices.resize(first_id.back());
+		each_strip([this, &first_id](size_t s, int x0, int x1) { numberVertices(x0, x1, first_id[s]); });
+		each_strip([this](size_t, int x0, int x1) { setOrigins(x0, x1); });
+
+		m_out_edges.assign(m_mesh.vertices.size(), { VoronoiMesh::none, VoronoiMesh::none, VoronoiMesh::none, VoronoiMesh::none });
+		alternate_strips([this](int x0, int x1) { listOutEdges(x0, x1); });
+		m_mesh.twin.assign(half_edges, VoronoiMesh::none);
+		each_strip([this](size_t, int x0, int x1) { linkTwins(x0, x1); });
+
+		std::vector<std::vector<ActiveEdge>> found(strips);
+		each_strip([this, &found](size_t s, int x0, int x1) { findActiveEdges(x0, x1, found[s]); });
+		for (size_t s = 1; s < strips; s++) found[0].insert(found[0].end(), found[s].begin(), found[s].end());
+		m_active_edges.assign(std::move(found[0]));
+
+		labelRegions();
+		traceRegions();
+
+		// only needed while building
+		std::vector<LatticePoint>().swap(m_points);
+		std::vector<uint32_t>().swap(m_first_edge);
+		std::vector<std::array<uint32_t, 4>>().swap(m_out_edges);
 	}
 
 	const possible_cells_list& VoronoiDiagram::getPossibleVoronoiCells() const {
-		return cellsCalculation.possibleCells;
+		return possibleCells;
 	}
 
-	const diagram& VoronoiDiagram::getDiagram() {
-		return m_diagram;
+	const VoronoiMesh& VoronoiDiagram::getDiagram() const {
+		return m_mesh;
 	}
 
-	const edge_list& VoronoiDiagram::getActiveEdges() {
+	const edge_list& VoronoiDiagram::getActiveEdges() const {
 		return m_active_edges;
 	}
 
+	const RegionPolygons& VoronoiDiagram::getRegions() const {
+		return m_regions;
+	}
+
 }